@@ -127,6 +127,17 @@ Directory::Remove(const char *name)
     return true;
 }
 
+/// Return an entry of the directory table, so that callers can walk it.
+///
+/// * `i` is the index into the table.
+const DirectoryEntry *
+Directory::GetEntry(int i)
+{
+    if (i < 0 || i >= tableSize)
+        return NULL;
+    return &table[i];
+}
+
 /// List all the file names in the directory.
 void
 Directory::List()
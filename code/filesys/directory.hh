@@ -70,6 +70,10 @@ public:
     /// Remove a file from the directory.
     bool Remove(const char *name);
 
+    /// Return the `i`-th entry of the table, in use or not, or `NULL` past
+    /// the end of the table.
+    const DirectoryEntry *GetEntry(int i);
+
     /// Print the names of all the files in the directory.
     void List();
 
@@ -8,6 +8,10 @@
 /// blocks). The table size is chosen so that the file header will be just
 /// big enough to fit in one disk sector,
 ///
+/// Files small enough to fit in the space of that table are stored there
+/// instead, and take no data blocks.  Since files have a fixed size, this is
+/// decided once and for all when the file is created.
+///
 /// Unlike in a real system, we do not keep track of file permissions,
 /// ownership, last modification date, etc., in the file header.
 ///
@@ -37,6 +41,12 @@ bool
 FileHeader::Allocate(BitMap *freeMap, unsigned fileSize)
 {
     numBytes = fileSize;
+    if (fileSize <= MAX_INLINE_SIZE) {
+        numSectors = 0;
+        memset(data, 0, sizeof data);
+        return true;
+    }
+
     numSectors = divRoundUp(fileSize, SECTOR_SIZE);
     if (freeMap->NumClear() < numSectors)
         return false;  // Not enough space.
@@ -85,6 +95,7 @@ FileHeader::WriteBack(unsigned sector)
 unsigned
 FileHeader::ByteToSector(unsigned offset)
 {
+    ASSERT(!IsInline());
     return dataSectors[offset / SECTOR_SIZE];
 }
 
@@ -95,26 +106,67 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+unsigned
+FileHeader::NumSectors()
+{
+    return numSectors;
+}
+
+void
+FileHeader::Relocate(unsigned firstSector)
+{
+    for (unsigned i = 0; i < numSectors; i++)
+        dataSectors[i] = firstSector + i;
+}
+
+bool
+FileHeader::IsInline()
+{
+    return numSectors == 0;
+}
+
+char *
+FileHeader::InlineData()
+{
+    ASSERT(IsInline());
+    return data;
+}
+
+/// Print `size` bytes of file contents, escaping the unprintable ones.
+static void
+PrintContents(const char *contents, unsigned size)
+{
+    for (unsigned j = 0; j < size; j++) {
+        if ('\040' <= contents[j] && contents[j] <= '\176')  // isprint
+            printf("%c", contents[j]);
+        else
+            printf("\\%X", (unsigned char) contents[j]);
+    }
+    printf("\n");
+}
+
 /// Print the contents of the file header, and the contents of all the data
 /// blocks pointed to by the file header.
 void
 FileHeader::Print()
 {
-    char *data = new char[SECTOR_SIZE];
+    if (IsInline()) {
+        printf("FileHeader contents.  File size: %d.  Inline.\n", numBytes);
+        printf("File contents:\n");
+        PrintContents(data, numBytes);
+        return;
+    }
+
+    char *sectorData = new char[SECTOR_SIZE];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (unsigned i = 0; i < numSectors; i++)
         printf("%d ", dataSectors[i]);
     printf("\nFile contents:\n");
-    for (unsigned i = 0, k = 0; i < numSectors; i++) {
-        synchDisk->ReadSector(dataSectors[i], data);
-        for (unsigned j = 0; j < SECTOR_SIZE && k < numBytes; j++, k++) {
-            if ('\040' <= data[j] && data[j] <= '\176')  // isprint(data[j])
-                printf("%c", data[j]);
-            else
-                printf("\\%X", (unsigned char) data[j]);
-        }
-        printf("\n");
+    for (unsigned i = 0, k = 0; i < numSectors; i++, k += SECTOR_SIZE) {
+        synchDisk->ReadSector(dataSectors[i], sectorData);
+        PrintContents(sectorData,
+                      numBytes - k < SECTOR_SIZE ? numBytes - k : SECTOR_SIZE);
     }
-    delete [] data;
+    delete [] sectorData;
 }
@@ -20,6 +20,10 @@
 #define NUM_DIRECT     ((SECTOR_SIZE - 2 * sizeof (int)) / sizeof (int))
 #define MAX_FILE_SIZE  (NUM_DIRECT * SECTOR_SIZE)
 
+/// Files up to this size keep their contents inside the header sector,
+/// where the table of data sectors would otherwise be.
+#define MAX_INLINE_SIZE  (NUM_DIRECT * sizeof (unsigned))
+
 /// The following class defines the Nachos "file header" (in UNIX terms, the
 /// “i-node”), describing where on disk to find all of the data in the file.
 /// The file header is organized as a simple table of pointers to data
@@ -31,6 +35,10 @@
 /// Without indirect addressing, this limits the maximum file length to just
 /// under 4K bytes.
 ///
+/// Small files (up to `MAX_INLINE_SIZE` bytes) need no data blocks at all:
+/// their contents are stored in the header itself, so reading one costs a
+/// single disk access.  Such a header has `numSectors == 0`.
+///
 /// There is no constructor; rather the file header can be initialized
 /// by allocating blocks for the file (if it is a new file), or by
 /// reading it from disk.
@@ -57,14 +65,31 @@ public:
     /// Return the length of the file in bytes
     unsigned FileLength();
 
+    /// Return the number of data sectors (none, for an inline file).
+    unsigned NumSectors();
+
+    /// Point the header at the consecutive sectors starting at
+    /// `firstSector`.  Moving the data there is up to the caller.
+    void Relocate(unsigned firstSector);
+
+    /// Is the file data stored inside the header?
+    bool IsInline();
+
+    /// Return the file data stored inside the header.  Only valid if
+    /// `IsInline`.
+    char *InlineData();
+
     /// Print the contents of the file.
     void Print();
 
   private:
     unsigned numBytes;  ///< Number of bytes in the file
     unsigned numSectors;  ///< Number of data sectors in the file
-    unsigned dataSectors[NUM_DIRECT];  ///< Disk sector numbers for each data
-                                       ///< block in the file.
+    union {
+        unsigned dataSectors[NUM_DIRECT];  ///< Disk sector numbers for each
+                                           ///< data block in the file.
+        char data[MAX_INLINE_SIZE];  ///< Contents of an inline file.
+    };
 };
 
 
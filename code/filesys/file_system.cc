@@ -25,9 +25,20 @@
 /// directory and/or bitmap, we simply discard the changed version, without
 /// writing it back to disk.
 ///
+/// Concurrent accesses are synchronized with a lock for the directory and
+/// another for the bitmap; when both are needed, the directory lock is taken
+/// first.  Accesses to the contents of files are synchronized by the files
+/// themselves (cf. `open_file.cc`).
+///
+/// A file that is removed while open disappears from the directory at once,
+/// but its sectors are only given back when it is closed for the last time.
+///
+/// Data sectors are handed out lowest first, so after some creating and
+/// removing, files end up interleaved.  `Defragment` moves each file back
+/// into one contiguous run; it may run while the files are in use.
+///
 /// Our implementation at this point has the following restrictions:
 ///
-/// * there is no synchronization for concurrent accesses;
 /// * files have a fixed size, set when the file is created;
 /// * files cannot be bigger than about 3KB in size;
 /// * there is no hierarchical directory structure, and only a limited number
@@ -45,8 +56,11 @@
 #include "file_system.hh"
 #include "directory.hh"
 #include "file_header.hh"
+#include "file_table.hh"
 #include "machine/disk.hh"
 #include "userprog/bitmap.hh"
+#include "threads/synch.hh"
+#include "threads/system.hh"
 
 
 /// Sectors containing the file headers for the bitmap of free sectors, and
@@ -55,14 +69,19 @@
 static const unsigned FREE_MAP_SECTOR = 0;
 static const unsigned DIRECTORY_SECTOR = 1;
 
-/// Initial file sizes for the bitmap and directory; until the file system
-/// supports extensible files, the directory size sets the maximum number of
-/// files that can be loaded onto the disk.
-static const unsigned FREE_MAP_FILE_SIZE = NUM_SECTORS / BitsInByte;
-static const unsigned NUM_DIR_ENTRIES = 10;
+/// Initial file sizes for the bitmap and directory; the directory has room
+/// for `NUM_DIR_ENTRIES` files.
+///
+/// The size of the bitmap depends on how many spindles the volume has, so it
+/// is computed from `synchDisk->NumSectors()` at run time.
 static const unsigned DIRECTORY_FILE_SIZE = sizeof (DirectoryEntry)
                                             * NUM_DIR_ENTRIES;
 
+#ifdef VMEM
+/// Part of the volume kept for the swap area: one sector out of this many.
+static const unsigned SWAP_SHARE = 4;
+#endif
+
 /// Initialize the file system.  If `format == true`, the disk has nothing on
 /// it, and we need to initialize the disk to contain an empty directory, and
 /// a bitmap of free sectors (with almost but not all of the sectors marked
@@ -75,8 +94,10 @@ static const unsigned DIRECTORY_FILE_SIZE = sizeof (DirectoryEntry)
 FileSystem::FileSystem(bool format)
 {
     DEBUG('f', "Initializing the file system.\n");
+    freeMapLock   = new Lock("free map");
+    directoryLock = new Lock("directory");
     if (format) {
-        BitMap     *freeMap   = new BitMap(NUM_SECTORS);
+        BitMap     *freeMap   = new BitMap(synchDisk->NumSectors());
         Directory  *directory = new Directory(NUM_DIR_ENTRIES);
         FileHeader *mapHeader = new FileHeader;
         FileHeader *dirHeader = new FileHeader;
@@ -87,11 +108,17 @@ FileSystem::FileSystem(bool format)
         // (make sure no one else grabs these!)
         freeMap->Mark(FREE_MAP_SECTOR);
         freeMap->Mark(DIRECTORY_SECTOR);
+#ifdef VMEM
+        for (unsigned i = 0; i < SwapSectors(); i++)
+            freeMap->Mark(SwapStart() + i);
+#endif
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
 
-        ASSERT(mapHeader->Allocate(freeMap, FREE_MAP_FILE_SIZE));
+        ASSERT(mapHeader->Allocate(freeMap,
+                                   divRoundUp(synchDisk->NumSectors(),
+                                              BitsInByte)));
         ASSERT(dirHeader->Allocate(freeMap, DIRECTORY_FILE_SIZE));
 
         // Flush the bitmap and directory `FileHeader`s back to disk.
@@ -138,6 +165,20 @@ FileSystem::FileSystem(bool format)
     }
 }
 
+#ifdef VMEM
+unsigned
+FileSystem::SwapStart()
+{
+    return synchDisk->NumSectors() - SwapSectors();
+}
+
+unsigned
+FileSystem::SwapSectors()
+{
+    return synchDisk->NumSectors() / SWAP_SHARE;
+}
+#endif
+
 /// Create a file in the Nachos file system (similar to UNIX `create`).
 /// Since we cannot increase the size of files dynamically, we have to give
 /// Create the initial size of the file.
@@ -158,9 +199,6 @@ FileSystem::FileSystem(bool format)
 /// * no free entry for file in directory;
 /// * no free space for data blocks for the file.
 ///
-/// Note that this implementation assumes there is no concurrent access to
-/// the file system!
-///
 /// * `name` is the name of file to be created.
 /// * `initialSize` is the size of file to be created.
 bool
@@ -174,13 +212,15 @@ FileSystem::Create(const char *name, int initialSize)
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
+    directoryLock->Acquire();
     directory = new Directory(NUM_DIR_ENTRIES);
     directory->FetchFrom(directoryFile);
 
     if (directory->Find(name) != -1)
         success = false;  // File is already in directory.
     else {
-        freeMap = new BitMap(NUM_SECTORS);
+        freeMapLock->Acquire();
+        freeMap = new BitMap(synchDisk->NumSectors());
         freeMap->FetchFrom(freeMapFile);
         sector = freeMap->Find();  // Find a sector to hold the file header.
         if (sector == -1)
@@ -201,8 +241,10 @@ FileSystem::Create(const char *name, int initialSize)
             delete header;
         }
         delete freeMap;
+        freeMapLock->Release();
     }
     delete directory;
+    directoryLock->Release();
     return success;
 }
 
@@ -221,10 +263,12 @@ FileSystem::Open(const char *name)
     int        sector;
 
     DEBUG('f', "Opening file %s\n", name);
+    directoryLock->Acquire();
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name);
     if (sector >= 0)
         openFile = new OpenFile(sector);  // `name` was found in directory.
+    directoryLock->Release();
     delete directory;
     return openFile;  // Return `NULL` if not found.
 }
@@ -233,9 +277,9 @@ FileSystem::Open(const char *name)
 ///
 /// This requires:
 /// 1. Remove it from the directory.
-/// 2. Delete the space for its header.
-/// 3. Delete the space for its data blocks.
-/// 4. Write changes to directory, bitmap back to disk.
+/// 2. Write changes to the directory back to disk.
+/// 3. Delete the space for its header and data blocks, unless the file is
+///    still open; then that is left to whoever closes it last.
 ///
 /// Return true if the file was deleted, false if the file was not in the
 /// file system.
@@ -245,42 +289,60 @@ bool
 FileSystem::Remove(const char *name)
 {
     Directory  *directory;
-    BitMap     *freeMap;
     FileHeader *fileHeader;
     int         sector;
 
+    directoryLock->Acquire();
     directory = new Directory(NUM_DIR_ENTRIES);
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name);
     if (sector == -1) {
        delete directory;
+       directoryLock->Release();
        return false;  // file not found
     }
-    fileHeader = new FileHeader;
-    fileHeader->FetchFrom(sector);
-
-    freeMap = new BitMap(NUM_SECTORS);
-    freeMap->FetchFrom(freeMapFile);
-
-    fileHeader->Deallocate(freeMap);  // Remove data blocks.
-    freeMap->Clear(sector);           // Remove header block.
     directory->Remove(name);
-
-    freeMap->WriteBack(freeMapFile);      // Flush to disk.
     directory->WriteBack(directoryFile);  // Flush to disk.
-    delete fileHeader;
+
+    if (!fileTable->MarkRemoved(sector)) {
+        fileHeader = new FileHeader;
+        fileHeader->FetchFrom(sector);
+        Reclaim(sector, fileHeader);
+        delete fileHeader;
+    }
     delete directory;
-    delete freeMap;
+    directoryLock->Release();
     return true;
 }
 
+/// Give back the header and data sectors of a file that is no longer in the
+/// directory.
+///
+/// * `sector` is the location on disk of the file header.
+/// * `hdr` is the file header.
+void
+FileSystem::Reclaim(unsigned sector, FileHeader *hdr)
+{
+    BitMap *freeMap = new BitMap(synchDisk->NumSectors());
+
+    freeMapLock->Acquire();
+    freeMap->FetchFrom(freeMapFile);
+    hdr->Deallocate(freeMap);  // Remove data blocks.
+    freeMap->Clear(sector);    // Remove header block.
+    freeMap->WriteBack(freeMapFile);  // Flush to disk.
+    freeMapLock->Release();
+    delete freeMap;
+}
+
 /// List all the files in the file system directory.
 void
 FileSystem::List()
 {
     Directory *directory = new Directory(NUM_DIR_ENTRIES);
 
+    directoryLock->Acquire();
     directory->FetchFrom(directoryFile);
+    directoryLock->Release();
     directory->List();
     delete directory;
 }
@@ -296,7 +358,7 @@ FileSystem::Print()
 {
     FileHeader *bitHeader = new FileHeader;
     FileHeader *dirHeader = new FileHeader;
-    BitMap     *freeMap   = new BitMap(NUM_SECTORS);
+    BitMap     *freeMap   = new BitMap(synchDisk->NumSectors());
     Directory  *directory = new Directory(NUM_DIR_ENTRIES);
 
     printf("Bit map file header:\n");
@@ -307,10 +369,14 @@ FileSystem::Print()
     dirHeader->FetchFrom(DIRECTORY_SECTOR);
     dirHeader->Print();
 
+    freeMapLock->Acquire();
     freeMap->FetchFrom(freeMapFile);
+    freeMapLock->Release();
     freeMap->Print();
 
+    directoryLock->Acquire();
     directory->FetchFrom(directoryFile);
+    directoryLock->Release();
     directory->Print();
 
     delete bitHeader;
@@ -318,3 +384,209 @@ FileSystem::Print()
     delete freeMap;
     delete directory;
 }
+
+unsigned
+FileSystem::TrackSize()
+{
+    // Sector `s` is on track `s / NumDisks() / SECTORS_PER_TRACK` of its
+    // spindle (cf. `synch_disk.hh`).
+    return SECTORS_PER_TRACK * synchDisk->NumDisks();
+}
+
+/// A file is well placed if its data is in consecutive sectors, none of
+/// them on a track of its own unless the file needs it.
+bool
+FileSystem::IsWellPlaced(FileHeader *hdr)
+{
+    unsigned numSectors = hdr->NumSectors();
+    unsigned trackSize  = TrackSize();
+
+    if (numSectors == 0)
+        return true;
+
+    unsigned first = hdr->ByteToSector(0);
+    for (unsigned i = 1; i < numSectors; i++)
+        if (hdr->ByteToSector(i * SECTOR_SIZE) != first + i)
+            return false;
+    return numSectors > trackSize
+           || first / trackSize == (first + numSectors - 1) / trackSize;
+}
+
+int
+FileSystem::FindRun(BitMap *freeMap, unsigned numSectors)
+{
+    unsigned trackSize = TrackSize();
+    unsigned total     = synchDisk->NumSectors();
+
+    for (unsigned start = 0; start + numSectors <= total; start++) {
+        if (numSectors <= trackSize
+              && start % trackSize + numSectors > trackSize) {
+            start += trackSize - start % trackSize - 1;  // Next track.
+            continue;
+        }
+        unsigned i = 0;
+        while (i < numSectors && !freeMap->Test(start + i))
+            i++;
+        if (i == numSectors)
+            return start;
+        start += i;  // Skip past the busy sector.
+    }
+    return -1;
+}
+
+/// The update is ordered so that the disk is never left inconsistent: first
+/// the data is copied and the copy is marked in use on disk, then the
+/// header is written pointing at the copy, and only then the old sectors
+/// are given back.  Stopped half-way, the disk has at worst sectors in use
+/// by no file, never a file on free sectors.
+///
+/// The file is locked for writing meanwhile, so readers and writers of the
+/// file wait, but see the data in its new place as soon as they get in.
+///
+/// Assumes `directoryLock` is held, so that the file cannot be removed.
+///
+/// * `sector` is the location on disk of the file header.
+bool
+FileSystem::DefragmentFile(unsigned sector)
+{
+    SharedFile *file  = fileTable->Acquire(sector);
+    FileHeader *hdr   = file->hdr;
+    bool        moved = false;
+
+    file->lock->AcquireWrite();
+    freeMapLock->Acquire();
+
+    BitMap  *freeMap    = new BitMap(synchDisk->NumSectors());
+    unsigned numSectors = hdr->NumSectors();
+    freeMap->FetchFrom(freeMapFile);
+    int target = numSectors > 0 ? FindRun(freeMap, numSectors) : -1;
+
+    if (target != -1 && (!IsWellPlaced(hdr)
+                         || (unsigned) target < hdr->ByteToSector(0))) {
+        unsigned *oldSectors = new unsigned[numSectors];
+        unsigned *newSectors = new unsigned[numSectors];
+        char     *data       = new char[numSectors * SECTOR_SIZE];
+
+        DEBUG('f', "Moving file at sector %u to sectors %d to %d\n",
+              sector, target, target + numSectors - 1);
+        for (unsigned i = 0; i < numSectors; i++) {
+            oldSectors[i] = hdr->ByteToSector(i * SECTOR_SIZE);
+            newSectors[i] = target + i;
+            freeMap->Mark(target + i);
+        }
+        synchDisk->ReadSectors(oldSectors, numSectors, data);
+        synchDisk->WriteSectors(newSectors, numSectors, data);
+        freeMap->WriteBack(freeMapFile);
+
+        hdr->Relocate(target);
+        hdr->WriteBack(sector);
+
+        for (unsigned i = 0; i < numSectors; i++)
+            freeMap->Clear(oldSectors[i]);
+        freeMap->WriteBack(freeMapFile);
+        moved = true;
+
+        delete [] oldSectors;
+        delete [] newSectors;
+        delete [] data;
+    }
+
+    delete freeMap;
+    freeMapLock->Release();
+    file->lock->ReleaseWrite();
+    fileTable->Release(file);
+    return moved;
+}
+
+/// Files are handled one at a time, in directory order, releasing the
+/// directory in between so that other threads can create, open and remove
+/// files meanwhile.  Every file is moved to the lowest run of free sectors
+/// that holds it, so free space also ends up compacted towards the end of
+/// the disk.
+unsigned
+FileSystem::Defragment()
+{
+    Directory *directory = new Directory(NUM_DIR_ENTRIES);
+    unsigned   moved = 0;
+
+    for (int i = 0; ; i++) {
+        directoryLock->Acquire();
+        directory->FetchFrom(directoryFile);
+        const DirectoryEntry *entry = directory->GetEntry(i);
+        if (entry == NULL) {
+            directoryLock->Release();
+            break;
+        }
+        if (entry->inUse && DefragmentFile(entry->sector))
+            moved++;
+        directoryLock->Release();
+        currentThread->Yield();
+    }
+    delete directory;
+    return moved;
+}
+
+static void
+DefragmenterThread(void *arg)
+{
+    unsigned moved = fileSystem->Defragment();
+
+    printf("Defragmenter: moved %u files.\n", moved);
+}
+
+void
+FileSystem::StartDefragmenter()
+{
+    Thread *defragmenter = new Thread("defragmenter",
+                                      BACKGROUND_PRIORITY);
+
+    defragmenter->Fork(DefragmenterThread, NULL);
+}
+
+/// For every file, count the runs of consecutive sectors that make it up
+/// (its extents), and the tracks that the disk head crosses while reading
+/// it from start to end.  Then print the average over all files.
+void
+FileSystem::FragmentationReport()
+{
+    Directory  *directory = new Directory(NUM_DIR_ENTRIES);
+    FileHeader *hdr       = new FileHeader;
+    unsigned    trackSize = TrackSize();
+    unsigned    numFiles = 0, numFragmented = 0, totalSeek = 0;
+
+    directoryLock->Acquire();
+    directory->FetchFrom(directoryFile);
+    printf("Fragmentation report:\n");
+    for (int i = 0; directory->GetEntry(i) != NULL; i++) {
+        const DirectoryEntry *entry = directory->GetEntry(i);
+        if (!entry->inUse)
+            continue;
+
+        hdr->FetchFrom(entry->sector);
+        unsigned numSectors = hdr->NumSectors();
+        unsigned extents = numSectors > 0 ? 1 : 0, seek = 0;
+        for (unsigned j = 1; j < numSectors; j++) {
+            unsigned prev = hdr->ByteToSector((j - 1) * SECTOR_SIZE);
+            unsigned cur  = hdr->ByteToSector(j * SECTOR_SIZE);
+            if (cur != prev + 1)
+                extents++;
+            seek += cur / trackSize > prev / trackSize
+                    ? cur / trackSize - prev / trackSize
+                    : prev / trackSize - cur / trackSize;
+        }
+        printf("    %s: %u sectors, %u extents, seek distance %u tracks\n",
+               entry->name, numSectors, extents, seek);
+        numFiles++;
+        totalSeek += seek;
+        if (!IsWellPlaced(hdr))
+            numFragmented++;
+    }
+    directoryLock->Release();
+
+    printf("Average seek distance: %.2f tracks per file; %u of %u files"
+           " fragmented.\n",
+           numFiles > 0 ? (float) totalSeek / numFiles : 0.0,
+           numFragmented, numFiles);
+    delete hdr;
+    delete directory;
+}
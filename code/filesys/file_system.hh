@@ -67,6 +67,15 @@ public:
 };
 
 #else  // FILESYS
+class BitMap;
+class FileHeader;
+class Lock;
+
+/// Number of entries of the directory.  Until the file system supports
+/// extensible files, it is the most files the disk can have.  The bitmap
+/// and the directory themselves take none.
+const unsigned NUM_DIR_ENTRIES = 10;
+
 class FileSystem {
 public:
 
@@ -86,17 +95,55 @@ public:
     /// Delete a file (UNIX `unlink`).
     bool Remove(const char *name);
 
+    /// Give back the sectors of a removed file, once nobody has it open.
+    void Reclaim(unsigned sector, FileHeader *hdr);
+
     /// List all the files in the file system.
     void List();
 
     /// List all the files and their contents.
     void Print();
 
+    /// Move the data of every file into a contiguous run of sectors, kept
+    /// inside one track when it fits.  Return how many files were moved.
+    unsigned Defragment();
+
+    /// Run `Defragment` in a kernel thread of the lowest priority.
+    void StartDefragmenter();
+
+    /// Print how scattered the data of every file is.
+    void FragmentationReport();
+
+#ifdef VMEM
+    /// The region at the end of the volume kept for the swap area: its
+    /// first sector, and its size in sectors.  Formatting marks it in use,
+    /// so that no file ever takes it.
+
+    unsigned SwapStart();
+    unsigned SwapSectors();
+#endif
+
 private:
    OpenFile* freeMapFile;  ///< Bit map of free disk blocks, represented as a
                            ///< file.
    OpenFile* directoryFile;  ///< “Root” directory -- list of file names,
                              ///< represented as a file.
+   Lock *freeMapLock;  ///< Serializes updates to the bit map.
+   Lock *directoryLock;  ///< Serializes lookups and updates to the
+                         ///< directory.
+
+   /// Sectors per track of the whole volume.
+   unsigned TrackSize();
+
+   /// Is the data of `hdr` as good as `Defragment` would leave it?
+   bool IsWellPlaced(FileHeader *hdr);
+
+   /// Find the lowest run of `numSectors` free sectors of `freeMap` that
+   /// does not cross a track boundary, unless it is longer than a track.
+   int FindRun(BitMap *freeMap, unsigned numSectors);
+
+   /// Move the data of the file whose header is at `sector`, if worth it.
+   bool DefragmentFile(unsigned sector);
 };
 
 #endif
@@ -0,0 +1,105 @@
+/// Routines to manage the table of open files.
+///
+/// Files that are not open take no space in the table.  An entry is created
+/// the first time a file is opened, and it is destroyed when the last
+/// `OpenFile` for it is closed.  If the file was removed meanwhile, that is
+/// also the moment to give its sectors back.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "file_table.hh"
+#include "file_header.hh"
+#include "threads/synch.hh"
+#include "threads/system.hh"
+
+
+FileTable::FileTable()
+{
+    lock  = new Lock("file table");
+    files = NULL;
+}
+
+FileTable::~FileTable()
+{
+    while (files != NULL) {
+        SharedFile *file = files;
+
+        files = file->next;
+        delete file->hdr;
+        delete file->lock;
+        delete file;
+    }
+    delete lock;
+}
+
+/// Return the entry for `sector`, or `NULL` if the file is not open.
+///
+/// Assumes `lock` is held.
+SharedFile *
+FileTable::Find(unsigned sector)
+{
+    for (SharedFile *file = files; file != NULL; file = file->next)
+        if (file->sector == sector)
+            return file;
+    return NULL;
+}
+
+/// * `sector` is the location on disk of the file header.
+SharedFile *
+FileTable::Acquire(unsigned sector)
+{
+    lock->Acquire();
+    SharedFile *file = Find(sector);
+    if (file == NULL) {
+        file          = new SharedFile;
+        file->sector  = sector;
+        file->hdr     = new FileHeader;
+        file->hdr->FetchFrom(sector);
+        file->refs    = 0;
+        file->removed = false;
+        file->lock    = new ReaderWriterLock("file");
+        file->next    = files;
+        files         = file;
+    }
+    file->refs++;
+    lock->Release();
+    return file;
+}
+
+void
+FileTable::Release(SharedFile *file)
+{
+    lock->Acquire();
+    ASSERT(file->refs > 0);
+    if (--file->refs > 0) {
+        lock->Release();
+        return;
+    }
+
+    SharedFile **prev = &files;
+    while (*prev != file)
+        prev = &(*prev)->next;
+    *prev = file->next;
+    lock->Release();
+
+    if (file->removed)
+        fileSystem->Reclaim(file->sector, file->hdr);
+    delete file->hdr;
+    delete file->lock;
+    delete file;
+}
+
+bool
+FileTable::MarkRemoved(unsigned sector)
+{
+    lock->Acquire();
+    SharedFile *file = Find(sector);
+    if (file != NULL)
+        file->removed = true;
+    lock->Release();
+    return file != NULL;
+}
@@ -0,0 +1,67 @@
+/// Data structures to share the in-core state of open files.
+///
+/// Every `OpenFile` for the same file points at the same `SharedFile`, so
+/// that all of them see the same file header, and synchronize through the
+/// same lock.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_FILESYS_FILETABLE__HH
+#define NACHOS_FILESYS_FILETABLE__HH
+
+
+class FileHeader;
+class Lock;
+class ReaderWriterLock;
+
+/// In-core state of a file that is open at least once.
+///
+/// The fields are public to make it simpler to manipulate; only
+/// `FileTable` creates and destroys these.
+class SharedFile {
+public:
+    unsigned sector;  ///< Sector of the file header; identifies the file.
+    FileHeader *hdr;  ///< In-core copy of the header.
+    unsigned refs;  ///< Number of `OpenFile`s using this entry.
+    bool removed;  ///< Already removed from the directory; its sectors are
+                   ///< freed when the last `OpenFile` is closed.
+    ReaderWriterLock *lock;  ///< Readers of the file share it, writers
+                             ///< hold it alone.
+    SharedFile *next;  ///< Next entry of the table.
+};
+
+/// The table of open files.
+class FileTable {
+public:
+
+    FileTable();
+
+    ~FileTable();
+
+    /// Return the entry for the file whose header is at `sector`, creating
+    /// it (and reading the header from disk) if the file was not open.
+    SharedFile *Acquire(unsigned sector);
+
+    /// Drop a reference to `file`, obtained from `Acquire`.
+    void Release(SharedFile *file);
+
+    /// Mark the file at `sector` as removed.  Return false if it is not
+    /// open, in which case the caller must free its sectors right away.
+    bool MarkRemoved(unsigned sector);
+
+private:
+
+    /// Protects the table.
+    Lock *lock;
+
+    /// Entries for the open files.
+    SharedFile *files;
+
+    SharedFile *Find(unsigned sector);
+};
+
+
+#endif
@@ -5,6 +5,8 @@
 /// * Print -- cat the contents of a Nachos file.
 /// * Perftest -- a stress test for the Nachos file system read and write a
 ///   really large file in tiny chunks (will not work on baseline system!)
+/// * FileSystemBenchmark -- time a set of workloads, to compare file system
+///   changes against each other.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -12,6 +14,8 @@
 /// limitation of liability and disclaimer of warranty provisions.
 
 
+#include "directory.hh"
+#include "file_header.hh"
 #include "file_system.hh"
 #include "machine/disk.hh"
 #include "machine/statistics.hh"
@@ -19,6 +23,8 @@
 #include "threads/system.hh"
 #include "threads/utility.hh"
 
+#include <sys/time.h>
+
 
 #define TransferSize  10  // Make it small, just to be difficult.
 
@@ -175,3 +181,498 @@ PerformanceTest()
     }
     stats->Print();
 }
+
+
+/// File system benchmarks
+///
+/// `nachos -fb <workload>` runs one of the workloads below (or `all` of
+/// them) on a freshly formatted disk, and prints a line per workload:
+///
+///     fsbench workload=<name> ops=<n> ticks=<n> reads=<n> writes=<n>
+///             seek=<n> wall_us=<n> status=<ok|FAIL>
+///
+/// (all in one line).  `ticks` is simulated time, `reads` and `writes` count
+/// disk sectors, `seek` counts tracks crossed by the disk heads, and
+/// `wall_us` is host time in microseconds.  Only the workload itself is
+/// measured, not the preparation of its files.
+///
+/// Files have a fixed size (at most `MAX_FILE_SIZE`) and the directory only
+/// has room for a few entries, so the workloads are kept within those
+/// limits.
+
+static const unsigned BENCH_FILE_SIZE = MAX_FILE_SIZE;
+static const unsigned BENCH_CHUNK = 100;  ///< Unaligned on purpose.
+static const unsigned BENCH_PASSES = 4;
+static const unsigned BENCH_RANDOM_OPS = 64;
+static const unsigned BENCH_STORM_FILES = 32;
+static const unsigned BENCH_SMALL_FILES = NUM_DIR_ENTRIES;  ///< All of them.
+static const unsigned BENCH_SMALL_SIZE = MAX_INLINE_SIZE;
+static const unsigned BENCH_SMALL_ROUNDS = 8;
+static const unsigned BENCH_THREADS = 2;  ///< Readers, and also writers.
+
+/// Result of a workload: how many operations it did, and whether it saw the
+/// data it expected.
+struct BenchResult {
+    unsigned ops;
+    bool ok;
+};
+
+/// Deterministic pseudo-random numbers, so that every run of a workload
+/// does the same requests no matter the `-rs` seed.
+static unsigned benchSeed;
+
+static unsigned
+BenchRandom()
+{
+    benchSeed = benchSeed * 1103515245 + 12345;
+    return (benchSeed >> 16) & 0x7FFF;
+}
+
+/// Byte expected at `offset` of a benchmark file filled by `FillPattern`.
+static inline char
+PatternByte(unsigned offset, unsigned salt)
+{
+    return 'a' + (offset + salt) % 26;
+}
+
+static void
+FillPattern(char *buffer, unsigned offset, unsigned size, unsigned salt)
+{
+    for (unsigned i = 0; i < size; i++)
+        buffer[i] = PatternByte(offset + i, salt);
+}
+
+static bool
+CheckPattern(const char *buffer, unsigned offset, unsigned size,
+             unsigned salt)
+{
+    for (unsigned i = 0; i < size; i++)
+        if (buffer[i] != PatternByte(offset + i, salt))
+            return false;
+    return true;
+}
+
+/// Create `name` with `size` bytes of pattern `salt`.
+static bool
+BenchCreate(const char *name, unsigned size, unsigned salt)
+{
+    if (!fileSystem->Create(name, size))
+        return false;
+    OpenFile *file = fileSystem->Open(name);
+    if (file == NULL)
+        return false;
+
+    char *buffer = new char[size];
+    FillPattern(buffer, 0, size, salt);
+    bool ok = file->WriteAt(buffer, size, 0) == (int) size;
+    delete [] buffer;
+    delete file;
+    return ok;
+}
+
+/// Write the whole of `name` sequentially, `BENCH_CHUNK` bytes at a time.
+static bool
+BenchWriteSequential(const char *name, unsigned salt, unsigned *ops)
+{
+    OpenFile *file = fileSystem->Open(name);
+    if (file == NULL)
+        return false;
+
+    char buffer[BENCH_CHUNK];
+    bool ok = true;
+    for (unsigned offset = 0; ok && offset < BENCH_FILE_SIZE;
+         offset += BENCH_CHUNK) {
+        unsigned size = BENCH_FILE_SIZE - offset < BENCH_CHUNK
+                        ? BENCH_FILE_SIZE - offset : BENCH_CHUNK;
+        FillPattern(buffer, offset, size, salt);
+        ok = file->Write(buffer, size) == (int) size;
+        (*ops)++;
+    }
+    delete file;
+    return ok;
+}
+
+/// Read the whole of `name` sequentially, checking its contents.
+static bool
+BenchReadSequential(const char *name, unsigned salt, unsigned *ops)
+{
+    OpenFile *file = fileSystem->Open(name);
+    if (file == NULL)
+        return false;
+
+    char buffer[BENCH_CHUNK];
+    bool ok = true;
+    for (unsigned offset = 0; ok && offset < BENCH_FILE_SIZE;
+         offset += BENCH_CHUNK) {
+        unsigned size = BENCH_FILE_SIZE - offset < BENCH_CHUNK
+                        ? BENCH_FILE_SIZE - offset : BENCH_CHUNK;
+        ok = file->Read(buffer, size) == (int) size
+             && CheckPattern(buffer, offset, size, salt);
+        (*ops)++;
+    }
+    delete file;
+    return ok;
+}
+
+static void
+SeqWritePrepare()
+{
+    fileSystem->Create("BenchSeq", BENCH_FILE_SIZE);
+}
+
+static BenchResult
+SeqWriteRun()
+{
+    BenchResult result = { 0, true };
+    for (unsigned pass = 0; result.ok && pass < BENCH_PASSES; pass++)
+        result.ok = BenchWriteSequential("BenchSeq", pass, &result.ops);
+    return result;
+}
+
+static void
+SeqReadPrepare()
+{
+    BenchCreate("BenchSeq", BENCH_FILE_SIZE, 0);
+}
+
+static BenchResult
+SeqReadRun()
+{
+    BenchResult result = { 0, true };
+    for (unsigned pass = 0; result.ok && pass < BENCH_PASSES; pass++)
+        result.ok = BenchReadSequential("BenchSeq", 0, &result.ops);
+    return result;
+}
+
+static void
+SeqCleanup()
+{
+    fileSystem->Remove("BenchSeq");
+}
+
+static void
+RandomPrepare()
+{
+    BenchCreate("BenchRnd", BENCH_FILE_SIZE, 0);
+}
+
+/// Alternate reads and writes of 4 bytes up to 4 KB (or the whole file,
+/// whichever is smaller) at random offsets.  Writes keep the pattern, so
+/// every read can be checked.
+static BenchResult
+RandomRun()
+{
+    BenchResult result = { 0, true };
+    OpenFile   *file = fileSystem->Open("BenchRnd");
+    if (file == NULL) {
+        result.ok = false;
+        return result;
+    }
+
+    unsigned maxSize = BENCH_FILE_SIZE < 4096 ? BENCH_FILE_SIZE : 4096;
+    char    *buffer  = new char[maxSize];
+    for (unsigned i = 0; result.ok && i < BENCH_RANDOM_OPS; i++) {
+        unsigned size = 4 << BenchRandom() % 11;  // 4 bytes up to 4 KB.
+        if (size > maxSize)
+            size = maxSize;
+        unsigned offset = BenchRandom() % (BENCH_FILE_SIZE - size + 1);
+
+        if (i % 2 == 0) {
+            FillPattern(buffer, offset, size, 0);
+            result.ok = file->WriteAt(buffer, size, offset) == (int) size;
+        } else
+            result.ok = file->ReadAt(buffer, size, offset) == (int) size
+                        && CheckPattern(buffer, offset, size, 0);
+        result.ops++;
+    }
+    delete [] buffer;
+    delete file;
+    return result;
+}
+
+static void
+RandomCleanup()
+{
+    fileSystem->Remove("BenchRnd");
+}
+
+/// Create and remove a one-sector file over and over, stressing the
+/// directory and the free map.
+static BenchResult
+CreateRemoveRun()
+{
+    BenchResult result = { 0, true };
+    for (unsigned i = 0; result.ok && i < BENCH_STORM_FILES; i++) {
+        result.ok = fileSystem->Create("BenchTmp", SECTOR_SIZE)
+                    && fileSystem->Remove("BenchTmp");
+        result.ops += 2;
+    }
+    return result;
+}
+
+static void
+SmallName(char *name, unsigned i)
+{
+    sprintf(name, "BenchSm%u", i);
+}
+
+/// Fill the directory with files small enough to live in their headers,
+/// read all of them back and remove them, a few rounds over.
+static BenchResult
+SmallFilesRun()
+{
+    BenchResult result = { 0, true };
+    char        name[FileNameMaxLen + 1];
+    char        buffer[BENCH_SMALL_SIZE];
+
+    for (unsigned round = 0; result.ok && round < BENCH_SMALL_ROUNDS;
+         round++) {
+        for (unsigned i = 0; result.ok && i < BENCH_SMALL_FILES; i++) {
+            SmallName(name, i);
+            result.ok = BenchCreate(name, BENCH_SMALL_SIZE, round + i);
+            result.ops++;
+        }
+
+        for (unsigned i = 0; result.ok && i < BENCH_SMALL_FILES; i++) {
+            SmallName(name, i);
+            OpenFile *file = fileSystem->Open(name);
+            result.ok = file != NULL
+                        && file->Read(buffer, BENCH_SMALL_SIZE)
+                           == (int) BENCH_SMALL_SIZE
+                        && CheckPattern(buffer, 0, BENCH_SMALL_SIZE,
+                                        round + i);
+            delete file;
+            result.ops++;
+        }
+
+        for (unsigned i = 0; result.ok && i < BENCH_SMALL_FILES; i++) {
+            SmallName(name, i);
+            result.ok = fileSystem->Remove(name);
+            result.ops++;
+        }
+    }
+    return result;
+}
+
+static void
+SmallFilesCleanup()
+{
+    char name[FileNameMaxLen + 1];
+
+    for (unsigned i = 0; i < BENCH_SMALL_FILES; i++) {
+        SmallName(name, i);
+        fileSystem->Remove(name);
+    }
+}
+
+/// State shared by the threads of the concurrent workload.
+static Semaphore *benchDone;
+static unsigned   benchOps;
+static bool       benchOk;
+
+static void
+WriterName(char *name, unsigned i)
+{
+    sprintf(name, "BenchW%u", i);
+}
+
+static void
+BenchReader(void *arg)
+{
+    unsigned ops = 0;
+
+    if (!BenchReadSequential("BenchSeq", 0, &ops))
+        benchOk = false;
+    benchOps += ops;
+    benchDone->V();
+}
+
+static void
+BenchWriter(void *arg)
+{
+    unsigned i = *(unsigned *) arg;
+    char     name[FileNameMaxLen + 1];
+    unsigned ops = 0;
+
+    WriterName(name, i);
+    if (!BenchWriteSequential(name, i, &ops))
+        benchOk = false;
+    benchOps += ops;
+    benchDone->V();
+}
+
+static void
+ConcurrentPrepare()
+{
+    char name[FileNameMaxLen + 1];
+
+    BenchCreate("BenchSeq", BENCH_FILE_SIZE, 0);
+    for (unsigned i = 0; i < BENCH_THREADS; i++) {
+        WriterName(name, i);
+        fileSystem->Create(name, BENCH_FILE_SIZE);
+    }
+}
+
+/// Several readers share one file while writers fill files of their own.
+static BenchResult
+ConcurrentRun()
+{
+    unsigned ids[BENCH_THREADS];
+
+    benchDone = new Semaphore("bench done", 0);
+    benchOps  = 0;
+    benchOk   = true;
+    for (unsigned i = 0; i < BENCH_THREADS; i++) {
+        ids[i] = i;
+        Thread *reader = new Thread("bench reader");
+        reader->Fork(BenchReader, NULL);
+        Thread *writer = new Thread("bench writer");
+        writer->Fork(BenchWriter, &ids[i]);
+    }
+    for (unsigned i = 0; i < 2 * BENCH_THREADS; i++)
+        benchDone->P();
+    delete benchDone;
+
+    BenchResult result = { benchOps, benchOk };
+    return result;
+}
+
+static void
+ConcurrentCleanup()
+{
+    char name[FileNameMaxLen + 1];
+
+    fileSystem->Remove("BenchSeq");
+    for (unsigned i = 0; i < BENCH_THREADS; i++) {
+        WriterName(name, i);
+        fileSystem->Remove(name);
+    }
+}
+
+/// Writers of the shared-file workload take turns over the chunks of one
+/// file: writer `i` writes chunks `i`, `i + BENCH_THREADS`, and so on.
+/// Chunks are not sector aligned, so neighbouring writers keep updating the
+/// same sectors.
+static void
+BenchSharedWriter(void *arg)
+{
+    unsigned  i    = *(unsigned *) arg;
+    OpenFile *file = fileSystem->Open("BenchSeq");
+    char      buffer[BENCH_CHUNK];
+
+    if (file == NULL)
+        benchOk = false;
+    else {
+        for (unsigned offset = i * BENCH_CHUNK; offset < BENCH_FILE_SIZE;
+             offset += BENCH_THREADS * BENCH_CHUNK) {
+            unsigned size = BENCH_FILE_SIZE - offset < BENCH_CHUNK
+                            ? BENCH_FILE_SIZE - offset : BENCH_CHUNK;
+            FillPattern(buffer, offset, size, 1);
+            if (file->WriteAt(buffer, size, offset) != (int) size)
+                benchOk = false;
+            benchOps++;
+        }
+        delete file;
+    }
+    benchDone->V();
+}
+
+static void
+SharedWritePrepare()
+{
+    BenchCreate("BenchSeq", BENCH_FILE_SIZE, 0);
+}
+
+/// Several writers update one file at once; afterwards, all of their
+/// writes must be there.
+static BenchResult
+SharedWriteRun()
+{
+    unsigned ids[BENCH_THREADS];
+
+    benchDone = new Semaphore("bench done", 0);
+    benchOps  = 0;
+    benchOk   = true;
+    for (unsigned i = 0; i < BENCH_THREADS; i++) {
+        ids[i] = i;
+        Thread *writer = new Thread("bench writer");
+        writer->Fork(BenchSharedWriter, &ids[i]);
+    }
+    for (unsigned i = 0; i < BENCH_THREADS; i++)
+        benchDone->P();
+    delete benchDone;
+
+    unsigned ops = 0;
+    if (!BenchReadSequential("BenchSeq", 1, &ops))
+        benchOk = false;
+
+    BenchResult result = { benchOps + ops, benchOk };
+    return result;
+}
+
+struct Workload {
+    const char *name;
+    VoidNoArgFunctionPtr prepare;  ///< May be `NULL`.
+    BenchResult (*run)();
+    VoidNoArgFunctionPtr cleanup;  ///< May be `NULL`.
+};
+
+static const Workload WORKLOADS[] = {
+    { "seqwrite",     SeqWritePrepare,   SeqWriteRun,     SeqCleanup        },
+    { "seqread",      SeqReadPrepare,    SeqReadRun,      SeqCleanup        },
+    { "random",       RandomPrepare,     RandomRun,       RandomCleanup     },
+    { "createremove", NULL,              CreateRemoveRun, NULL              },
+    { "smallfiles",   NULL,              SmallFilesRun,   SmallFilesCleanup },
+    { "concurrent",   ConcurrentPrepare, ConcurrentRun,   ConcurrentCleanup },
+    { "sharedwrite",  SharedWritePrepare, SharedWriteRun, SeqCleanup        },
+};
+
+static const unsigned NUM_WORKLOADS = sizeof WORKLOADS / sizeof *WORKLOADS;
+
+static void
+RunWorkload(const Workload *w)
+{
+    benchSeed = 1;
+    if (w->prepare != NULL)
+        w->prepare();
+
+    unsigned ticks  = stats->totalTicks;
+    unsigned reads  = stats->numDiskReads;
+    unsigned writes = stats->numDiskWrites;
+    unsigned seek   = stats->diskSeekTracks;
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+
+    BenchResult result = w->run();
+
+    gettimeofday(&end, NULL);
+    long wall = (end.tv_sec - start.tv_sec) * 1000000L
+                + (end.tv_usec - start.tv_usec);
+    printf("fsbench workload=%s ops=%u ticks=%u reads=%u writes=%u seek=%u"
+           " wall_us=%ld status=%s\n",
+           w->name, result.ops, stats->totalTicks - ticks,
+           stats->numDiskReads - reads, stats->numDiskWrites - writes,
+           stats->diskSeekTracks - seek, wall, result.ok ? "ok" : "FAIL");
+
+    if (w->cleanup != NULL)
+        w->cleanup();
+}
+
+/// Run the workload called `name`, or every one of them if it is `all`.
+void
+FileSystemBenchmark(const char *name)
+{
+    bool found = false;
+
+    for (unsigned i = 0; i < NUM_WORKLOADS; i++)
+        if (!strcmp(name, "all") || !strcmp(name, WORKLOADS[i].name)) {
+            RunWorkload(&WORKLOADS[i]);
+            found = true;
+        }
+    if (!found) {
+        printf("fsbench: unknown workload %s; try one of: all", name);
+        for (unsigned i = 0; i < NUM_WORKLOADS; i++)
+            printf(" %s", WORKLOADS[i].name);
+        printf("\n");
+    }
+}
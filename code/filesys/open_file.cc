@@ -3,7 +3,12 @@
 /// (in Nachos, by deleting the `OpenFile` data structure).
 ///
 /// Also as in UNIX, for convenience, we keep the file header in memory while
-/// the file is open.
+/// the file is open.  The header is kept in the table of open files, and
+/// shared by every `OpenFile` for the same file.
+///
+/// Reads of a file may proceed at the same time, but each write excludes
+/// every other access to the file, so that the read-modify-write of partial
+/// sectors in `WriteAt` cannot interleave with another one.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -13,6 +18,8 @@
 
 #include "open_file.hh"
 #include "file_header.hh"
+#include "file_table.hh"
+#include "threads/synch.hh"
 #include "threads/system.hh"
 
 
@@ -22,15 +29,27 @@
 /// * `sector` is the location on disk of the file header for this file.
 OpenFile::OpenFile(int sector)
 {
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    file = fileTable->Acquire(sector);
+    hdr  = file->hdr;
     seekPosition = 0;
 }
 
 /// Close a Nachos file, de-allocating any in-memory data structures.
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    fileTable->Release(file);
+}
+
+OpenFile *
+OpenFile::Duplicate()
+{
+    return new OpenFile(file->sector);
+}
+
+unsigned
+OpenFile::HeaderSector()
+{
+    return file->sector;
 }
 
 /// Change the current location within the open file -- the point at which
@@ -90,6 +109,9 @@ OpenFile::Write(const char *into, unsigned numBytes)
 ///     data that will be modified, and write back all the full or partial
 ///     sectors that are part of the request.
 ///
+/// Files stored inline in their header need no sector arithmetic: the data
+/// is already in memory, and writing it means writing the header back.
+///
 /// * `into` is the buffer to contain the data to be read from disk.
 /// * `from` is the buffer containing the data to be written to disk.
 /// * `numBytes` is the number of bytes to transfer.
@@ -101,6 +123,7 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
 {
     unsigned fileLength = hdr->FileLength();
     unsigned firstSector, lastSector, numSectors;
+    unsigned *sectors;
     char *buf;
 
     if (numBytes == 0 || position >= fileLength)
@@ -109,16 +132,27 @@ OpenFile::ReadAt(char *into, unsigned numBytes, unsigned position)
         numBytes = fileLength - position;
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
+    file->lock->AcquireRead();
+
+    if (hdr->IsInline()) {  // The data is right in the header.
+        memcpy(into, &hdr->InlineData()[position], numBytes);
+        file->lock->ReleaseRead();
+        return numBytes;
+    }
 
     firstSector = divRoundDown(position, SECTOR_SIZE);
     lastSector = divRoundDown(position + numBytes - 1, SECTOR_SIZE);
     numSectors = 1 + lastSector - firstSector;
 
-    // Read in all the full and partial sectors that we need.
+    // Read in all the full and partial sectors that we need, all at once so
+    // that sectors on different spindles are read in parallel.
     buf = new char[numSectors * SECTOR_SIZE];
+    sectors = new unsigned[numSectors];
     for (unsigned i = firstSector; i <= lastSector; i++)
-        synchDisk->ReadSector(hdr->ByteToSector(i * SECTOR_SIZE),
-                              &buf[(i - firstSector) * SECTOR_SIZE]);
+        sectors[i - firstSector] = hdr->ByteToSector(i * SECTOR_SIZE);
+    synchDisk->ReadSectors(sectors, numSectors, buf);
+    delete [] sectors;
+    file->lock->ReleaseRead();
 
     // Copy the part we want.
     memcpy(into, &buf[position - firstSector * SECTOR_SIZE], numBytes);
@@ -131,6 +165,7 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
 {
     unsigned fileLength = hdr->FileLength();
     unsigned firstSector, lastSector, numSectors;
+    unsigned *sectors;
     bool firstAligned, lastAligned;
     char *buf;
 
@@ -141,6 +176,14 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
 
+    if (hdr->IsInline()) {  // Update the header, and write it back.
+        file->lock->AcquireWrite();
+        memcpy(&hdr->InlineData()[position], from, numBytes);
+        hdr->WriteBack(file->sector);
+        file->lock->ReleaseWrite();
+        return numBytes;
+    }
+
     firstSector = divRoundDown(position, SECTOR_SIZE);
     lastSector  = divRoundDown(position + numBytes - 1, SECTOR_SIZE);
     numSectors  = 1 + lastSector - firstSector;
@@ -150,20 +193,26 @@ OpenFile::WriteAt(const char *from, unsigned numBytes, unsigned position)
     firstAligned = position == firstSector * SECTOR_SIZE;
     lastAligned  = position + numBytes == (lastSector + 1) * SECTOR_SIZE;
 
+    file->lock->AcquireWrite();
+
     // Read in first and last sector, if they are to be partially modified.
     if (!firstAligned)
-        ReadAt(buf, SECTOR_SIZE, firstSector * SECTOR_SIZE);
+        synchDisk->ReadSector(hdr->ByteToSector(firstSector * SECTOR_SIZE),
+                              buf);
     if (!lastAligned && (firstSector != lastSector || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SECTOR_SIZE],
-               SECTOR_SIZE, lastSector * SECTOR_SIZE);
+        synchDisk->ReadSector(hdr->ByteToSector(lastSector * SECTOR_SIZE),
+                              &buf[(lastSector - firstSector) * SECTOR_SIZE]);
 
     // Copy in the bytes we want to change.
     memcpy(&buf[position - firstSector * SECTOR_SIZE], from, numBytes);
 
     // Write modified sectors back.
+    sectors = new unsigned[numSectors];
     for (unsigned i = firstSector; i <= lastSector; i++)
-        synchDisk->WriteSector(hdr->ByteToSector(i * SECTOR_SIZE),
-                               &buf[(i - firstSector) * SECTOR_SIZE]);
+        sectors[i - firstSector] = hdr->ByteToSector(i * SECTOR_SIZE);
+    synchDisk->WriteSectors(sectors, numSectors, buf);
+    file->lock->ReleaseWrite();
+    delete [] sectors;
     delete [] buf;
     return numBytes;
 }
@@ -7,9 +7,9 @@
 /// `filesys.hh`).
 ///
 /// The other is the “real” implementation, that turns these operations into
-/// read and write disk sector requests.  In this baseline implementation of
-/// the file system, we do not worry about concurrent accesses to the file
-/// system by different threads -- this is part of the assignment.
+/// read and write disk sector requests.  Every `OpenFile` of the same file
+/// shares one in-core header and one readers/writer lock (cf.
+/// `file_table.hh`), so that different threads may access the file at once.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -34,6 +34,12 @@ public:
     /// Close the file.
     ~OpenFile() { Close(file); }
 
+    /// Open the same file again.
+    OpenFile *Duplicate() { return new OpenFile(::Duplicate(file)); }
+
+    /// Number identifying the file: its UNIX inode.
+    unsigned HeaderSector() { return Inode(file); }
+
     int ReadAt(char *into, unsigned numBytes, unsigned position) {
         Lseek(file, position, 0);
         return ReadPartial(file, into, numBytes);
@@ -63,6 +69,7 @@ private:
 
 #else // FILESYS
 class FileHeader;
+class SharedFile;
 
 class OpenFile {
 public:
@@ -73,6 +80,12 @@ public:
     /// Close the file.
     ~OpenFile();
 
+    /// Open the same file again, with a seek position of its own.
+    OpenFile *Duplicate();
+
+    /// Sector of the file header, which identifies the file.
+    unsigned HeaderSector();
+
     /// Set the position from which to start reading/writing -- UNIX `lseek`.
     void Seek(unsigned position);
 
@@ -92,6 +105,7 @@ public:
     unsigned Length();
 
   private:
+    SharedFile *file;  ///< In-core state shared with other openers.
     FileHeader *hdr;  ///< Header for this file.
     unsigned seekPosition;  ///< Current position within the file.
 };
@@ -5,7 +5,8 @@
 ///
 /// Use a semaphore to synchronize the interrupt handlers with the pending
 /// requests.  And, because the physical disk can only handle one operation
-/// at a time, use a lock to enforce mutual exclusion.
+/// at a time, every spindle keeps a queue of waiting requests; the interrupt
+/// handler starts the next one as soon as the previous one is done.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -14,6 +15,7 @@
 
 
 #include "synch_disk.hh"
+#include "threads/system.hh"
 
 
 /// Disk interrupt handler.  Need this to be a C routine, because C++ cannot
@@ -21,29 +23,48 @@
 static void
 DiskRequestDone(void *arg)
 {
-    SynchDisk *disk = (SynchDisk *) arg;
+    Spindle *spindle = (Spindle *) arg;
 
-    disk->RequestDone();
+    spindle->volume->RequestDone(spindle);
 }
 
-/// Initialize the synchronous interface to the physical disk, in turn
-/// initializing the physical disk.
+/// Initialize the synchronous interface to the physical disks, in turn
+/// initializing the physical disks.
 ///
 /// * `name` is a UNIX file name to be used as storage for the disk data
 ///   (usually, `DISK`).
-SynchDisk::SynchDisk(const char *name)
+/// * `numDisks` is the number of spindles to stripe the volume across.
+SynchDisk::SynchDisk(const char *name, unsigned numDisks_)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, this);
+    ASSERT(numDisks_ > 0 && numDisks_ <= MAX_DISKS);
+
+    numDisks    = numDisks_;
+    numActive   = 0;
+    activeSince = 0;
+    spindles    = new Spindle[numDisks];
+    for (unsigned i = 0; i < numDisks; i++) {
+        char *diskName = new char[strlen(name) + 16];
+
+        if (i == 0)
+            strcpy(diskName, name);
+        else
+            sprintf(diskName, "%s.%u", name, i);
+        spindles[i].volume  = this;
+        spindles[i].number  = i;
+        spindles[i].current = NULL;
+        spindles[i].lastTrack = 0;
+        spindles[i].disk    = new Disk(diskName, DiskRequestDone,
+                                       &spindles[i]);
+        delete [] diskName;
+    }
 }
 
 /// De-allocate data structures needed for the synchronous disk abstraction.
 SynchDisk::~SynchDisk()
 {
-    delete disk;
-    delete lock;
-    delete semaphore;
+    for (unsigned i = 0; i < numDisks; i++)
+        delete spindles[i].disk;
+    delete [] spindles;
 }
 
 /// Read the contents of a disk sector into a buffer.  Return only after the
@@ -54,10 +75,9 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char *data)
 {
-    lock->Acquire();  // Only one disk I/O at a time.
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();   // Wait for interrupt.
-    lock->Release();
+    unsigned sector = sectorNumber;
+
+    Transfer(&sector, 1, data, false);
 }
 
 /// Write the contents of a buffer into a disk sector.  Return only
@@ -68,16 +88,131 @@ SynchDisk::ReadSector(int sectorNumber, char *data)
 void
 SynchDisk::WriteSector(int sectorNumber, const char *data)
 {
-    lock->Acquire();  // only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();   // wait for interrupt
-    lock->Release();
+    unsigned sector = sectorNumber;
+
+    Transfer(&sector, 1, (char *) data, true);
+}
+
+/// Read several sectors at once.  Return only after all of them have been
+/// read.
+///
+/// * `sectors` are the disk sectors to read.
+/// * `count` is the number of entries in `sectors`.
+/// * `data` is the buffer to hold `count * SECTOR_SIZE` bytes.
+void
+SynchDisk::ReadSectors(const unsigned *sectors, unsigned count, char *data)
+{
+    Transfer(sectors, count, data, false);
+}
+
+/// Write several sectors at once.  Return only after all of them have been
+/// written.
+///
+/// * `sectors` are the disk sectors to write.
+/// * `count` is the number of entries in `sectors`.
+/// * `data` are the `count * SECTOR_SIZE` bytes to write.
+void
+SynchDisk::WriteSectors(const unsigned *sectors, unsigned count,
+                        const char *data)
+{
+    Transfer(sectors, count, (char *) data, true);
+}
+
+unsigned
+SynchDisk::NumSectors()
+{
+    return numDisks * NUM_SECTORS;
+}
+
+unsigned
+SynchDisk::NumDisks()
+{
+    return numDisks;
+}
+
+/// Hand every sector of a transfer to its spindle, then wait until all of
+/// them are done.
+///
+/// Interrupts are disabled while queueing, so that the interrupt handler
+/// sees either none or all of the requests of a spindle.
+void
+SynchDisk::Transfer(const unsigned *sectors, unsigned count, char *data,
+                    bool writing)
+{
+    DiskRequest *requests = new DiskRequest[count];
+    Semaphore    done("synch disk request", 0);
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    for (unsigned i = 0; i < count; i++) {
+        ASSERT(sectors[i] < NumSectors());
+        requests[i].sector  = sectors[i] / numDisks;
+        requests[i].data    = &data[i * SECTOR_SIZE];
+        requests[i].writing = writing;
+        requests[i].done    = &done;
+        Enqueue(&spindles[sectors[i] % numDisks], &requests[i]);
+    }
+    interrupt->SetLevel(oldLevel);
+
+    scheduler->BlocksOnIO(currentThread);
+    for (unsigned i = 0; i < count; i++)
+        done.P();  // Wait for interrupts.
+    delete [] requests;
+}
+
+/// Assumes interrupts are disabled.
+void
+SynchDisk::Enqueue(Spindle *spindle, DiskRequest *request)
+{
+    if (spindle->current == NULL)
+        Start(spindle, request);
+    else
+        spindle->queue.Append(request);
+}
+
+/// Assumes interrupts are disabled.
+void
+SynchDisk::Start(Spindle *spindle, DiskRequest *request)
+{
+    unsigned track = request->sector / SECTORS_PER_TRACK;
+
+    if (numActive++ == 0)
+        activeSince = stats->totalTicks;
+    stats->diskSeekTracks += track > spindle->lastTrack
+                             ? track - spindle->lastTrack
+                             : spindle->lastTrack - track;
+    spindle->lastTrack = track;
+    spindle->current   = request;
+    spindle->startTick = stats->totalTicks;
+    if (request->writing)
+        spindle->disk->WriteRequest(request->sector, request->data);
+    else
+        spindle->disk->ReadRequest(request->sector, request->data);
+}
+
+/// Disk interrupt handler.  Wake up the thread waiting for the request to
+/// finish, and send the next queued request to the disk, if any.
+void
+SynchDisk::RequestDone(Spindle *spindle)
+{
+    DiskRequest *request = spindle->current;
+
+    ASSERT(request != NULL);
+    stats->diskBusyTicks += stats->totalTicks - spindle->startTick;
+    if (--numActive == 0)
+        stats->diskActiveTicks += stats->totalTicks - activeSince;
+    spindle->current = NULL;
+    request->done->V();
+
+    if (!spindle->queue.IsEmpty())
+        Start(spindle, spindle->queue.Remove());
 }
 
-/// Disk interrupt handler.  Wake up any thread waiting for the disk
-/// request to finish.
 void
-SynchDisk::RequestDone()
+SynchDisk::RestartTicks(unsigned ticks)
 {
-    semaphore->V();
+    for (unsigned i = 0; i < numDisks; i++)
+        if (spindles[i].current != NULL)
+            spindles[i].startTick -= ticks;
+    if (numActive > 0)
+        activeSince -= ticks;
 }
@@ -13,6 +13,41 @@
 #include "threads/synch.hh"
 
 
+/// Maximum number of spindles a volume can be striped across.
+///
+/// The bitmap of free sectors is stored in a regular file, so it must not
+/// grow beyond `MAX_FILE_SIZE`.
+const unsigned MAX_DISKS = 16;
+
+class SynchDisk;
+
+/// A request for one sector, waiting to be served by a spindle.
+class DiskRequest {
+public:
+    unsigned sector;  ///< Sector number, relative to the spindle.
+    char *data;       ///< Buffer to read into or write from.
+    bool writing;     ///< Is this a write request?
+    Semaphore *done;  ///< Signalled when the request completes.
+    DiskRequest *next;  ///< Next request waiting for the same spindle.
+};
+
+/// One physical disk of the volume, with its own queue of pending requests.
+///
+/// The raw disk only accepts one request at a time, so the rest wait on
+/// `queue` and are started from the interrupt handler, one after the other.
+class Spindle {
+public:
+    SynchDisk *volume;  ///< Volume this spindle belongs to.
+    unsigned number;  ///< Position of the spindle inside the volume.
+    Disk *disk;  ///< Raw disk device.
+    DiskRequest *current;  ///< Request being served, `NULL` if idle.
+    unsigned startTick;  ///< When `current` was sent to the disk.
+    unsigned lastTrack;  ///< Track the head was left on.
+
+    /// Requests waiting for the disk.
+    IntrusiveList<DiskRequest, &DiskRequest::next> queue;
+};
+
 /// The following class defines a "synchronous" disk abstraction.
 ///
 /// As with other I/O devices, the raw physical disk is an asynchronous
@@ -23,11 +58,18 @@
 ///
 /// This class provides the abstraction that for any individual thread making
 /// a request, it waits around until the operation finishes before returning.
+///
+/// The volume may be striped across several disks (RAID-0): sector `s`
+/// lives in sector `s / numDisks` of disk `s % numDisks`, so consecutive
+/// sectors land on different spindles and can be transferred in parallel.
 class SynchDisk {
 public:
 
-    /// Initialize a synchronous disk, by initializing the raw Disk.
-    SynchDisk(const char* name);
+    /// Initialize a synchronous disk, by initializing the raw Disks.
+    ///
+    /// The first disk is stored in the UNIX file `name`, the rest in
+    /// `name.1`, `name.2`, and so on.
+    SynchDisk(const char* name, unsigned numDisks = 1);
 
     /// De-allocate the synch disk data.
     ~SynchDisk();
@@ -39,16 +81,43 @@ public:
     void ReadSector(int sectorNumber, char* data);
     void WriteSector(int sectorNumber, const char* data);
 
+    /// Read/write `count` sectors into/from consecutive `SECTOR_SIZE` slices
+    /// of `data`.  Requests for different spindles overlap in time.
+
+    void ReadSectors(const unsigned *sectors, unsigned count, char *data);
+    void WriteSectors(const unsigned *sectors, unsigned count,
+                      const char *data);
+
+    /// Number of sectors in the whole volume.
+    unsigned NumSectors();
+
+    /// Number of spindles the volume is striped across.
+    unsigned NumDisks();
+
     /// Called by the disk device interrupt handler, to signal that the
-    /// current disk operation is complete.
-    void RequestDone();
+    /// current operation of `spindle` is complete.
+    void RequestDone(Spindle *spindle);
+
+    /// Move the times kept for requests in flight `ticks` back, as the
+    /// clock is about to be, so that they are still charged what they
+    /// take.  Called by `Interrupt::RestartTicks`.
+    void RestartTicks(unsigned ticks);
 
 private:
-    Disk *disk;  ///< Raw disk device.
-    Semaphore *semaphore;  ///< To synchronize requesting thread with the
-                           ///< interrupt handler.
-    Lock *lock;  ///< Only one read/write request can be sent to the disk at
-                 ///< a time.
+    unsigned numDisks;  ///< Number of spindles.
+    Spindle *spindles;  ///< Raw disk devices, and their request queues.
+    unsigned numActive;  ///< Number of spindles currently busy.
+    unsigned activeSince;  ///< When `numActive` last became non-zero.
+
+    /// Split a transfer among the spindles and wait for all of it.
+    void Transfer(const unsigned *sectors, unsigned count, char *data,
+                  bool writing);
+
+    /// Queue `request` on `spindle`, starting it if the disk is idle.
+    void Enqueue(Spindle *spindle, DiskRequest *request);
+
+    /// Send `request` to the raw disk of `spindle`.
+    void Start(Spindle *spindle, DiskRequest *request);
 };
 
 
@@ -48,6 +48,7 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
     arg     = param;
     when    = time;
     type    = kind;
+    next    = NULL;
 }
 
 /// Initialize the simulation of hardware device interrupts.
@@ -56,7 +57,6 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
 Interrupt::Interrupt()
 {
     level         = INT_OFF;
-    pending       = new List<PendingInterrupt *>;
     inHandler     = false;
     yieldOnReturn = false;
     status        = SYSTEM_MODE;
@@ -65,9 +65,10 @@ Interrupt::Interrupt()
 /// De-allocate the data structures needed by the interrupt simulation.
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-        delete pending->Remove();
-    delete pending;
+    while (!pending.IsEmpty())
+        delete pending.Remove();
+    while (!spare.IsEmpty())
+        delete spare.Remove();
 }
 
 /// Change interrupts to be enabled or disabled, without advancing the
@@ -215,21 +216,19 @@ Interrupt::Halt()
 /// time, and after that, it would hang.
 void Interrupt::RestartTicks()
 {
-    PendingInterrupt *i = NULL;
-    unsigned          newWhen, oldWhen = 0;
-
-    List<PendingInterrupt *> *oldPending = pending;
-    pending = new List<PendingInterrupt *>;
-
-    while ((i = oldPending->SortedRemove((int *) &oldWhen)) != NULL)
-    {
-        newWhen = oldWhen - stats->totalTicks;
-        pending->SortedInsert(i, newWhen);
+    // Moving every interrupt back by the same time keeps them in order.
+    for (PendingInterrupt *i = pending.First(); i != NULL;
+         i = PendingList::Next(i)) {
+        unsigned oldWhen = i->when;
+        i->when = oldWhen - stats->totalTicks;
         DEBUG('x', "Interrupt at time %u re-scheduled at new time %u.\n",
-              oldWhen, newWhen);
+              oldWhen, i->when);
     }
+#ifdef FILESYS
+    if (synchDisk != NULL)
+        synchDisk->RestartTicks(stats->totalTicks);
+#endif
 
-    delete oldPending;
     stats->totalTicks = 0;
     stats->tickResets += 1;
 }
@@ -265,14 +264,28 @@ Interrupt::Schedule(VoidFunctionPtr handler, void *arg,
 #endif
 
     unsigned when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg,
-                                                     when, type);
+    PendingInterrupt *toOccur = spare.Remove();
+    if (toOccur != NULL)
+        *toOccur = PendingInterrupt(handler, arg, when, type);
+    else
+        toOccur = new PendingInterrupt(handler, arg, when, type);
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %u\n",
           INT_TYPE_NAMES[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    Insert(toOccur);
+}
+
+void
+Interrupt::Insert(PendingInterrupt *toOccur)
+{
+    PendingInterrupt *prev = NULL;
+
+    for (PendingInterrupt *i = pending.First();
+         i != NULL && i->when <= toOccur->when; i = PendingList::Next(i))
+        prev = i;
+    pending.InsertAfter(prev, toOccur);
 }
 
 /// Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -287,31 +300,28 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    unsigned      when;
 
     ASSERT(level == INT_OFF);  // Interrupts need to be disabled, to invoke
                                // an interrupt handler.
     if (DebugIsEnabled('i'))
         DumpState();
-    PendingInterrupt *toOccur = pending->SortedRemove((int *) &when);
+    PendingInterrupt *toOccur = pending.First();
 
     if (toOccur == NULL)  // No pending interrupts.
     return false;
 
+    unsigned when = toOccur->when;
     if (advanceClock && when > stats->totalTicks) {  // Advance the clock.
         stats->idleTicks += (when - stats->totalTicks);
         stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {  // Not time yet, put it back.
-        pending->SortedInsert(toOccur, when);
+    } else if (when > stats->totalTicks)  // Not time yet, leave it.
         return false;
-    }
 
     // Check if there is nothing more to do, and if so, quit.
     if (status == IDLE_MODE && toOccur->type == TIMER_INT
-          && pending->IsEmpty()) {
-        pending->SortedInsert(toOccur, when);
+          && PendingList::Next(toOccur) == NULL)
         return false;
-    }
+    pending.Remove();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %u\n",
             INT_TYPE_NAMES[toOccur->type], toOccur->when);
@@ -325,7 +335,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*toOccur->handler)(toOccur->arg);  // Call the interrupt handler.
     status = old;  // Restore the machine status.
     inHandler = false;
-    delete toOccur;
+    spare.Prepend(toOccur);
     return true;
 }
 
@@ -345,10 +355,10 @@ Interrupt::DumpState()
 {
     printf("Time: %u, interrupts %s\n",
            stats->totalTicks, INT_LEVEL_NAMES[level]);
-    if (pending->IsEmpty())
+    if (pending.IsEmpty())
         printf("No pending interrupts\n");
     else {
         printf("Pending interrupts:\n");
-        pending->Apply(PrintPending);
+        pending.Apply(PrintPending);
     }
 }
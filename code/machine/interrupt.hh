@@ -35,7 +35,7 @@
 #define NACHOS_MACHINE_INTERRUPT__HH
 
 
-#include "threads/list.hh"
+#include "threads/intrusive_list.hh"
 
 
 /// Interrupts can be disabled (`INT_OFF`) or enabled (`INT_ON`).
@@ -83,8 +83,12 @@ public:
     void *arg;  ///< The argument to the function.
     unsigned when;  ///< When the interrupt is supposed to fire.
     IntType type;  ///< For debugging.
+    PendingInterrupt *next;  ///< Next in the list it is on.
 };
 
+typedef IntrusiveList<PendingInterrupt, &PendingInterrupt::next>
+  PendingList;
+
 /// The following class defines the data structures for the simulation
 /// of hardware interrupts.
 ///
@@ -152,8 +156,10 @@ public:
 
 private:
     IntStatus level;  ///< Are interrupts enabled or disabled?
-    List<PendingInterrupt *> *pending;  ///< The list of interrupts scheduled
-                                        ///< to occur in the future.
+    PendingList pending;  ///< The list of interrupts scheduled to occur in
+                          ///< the future, in order of `when`.
+    PendingList spare;  ///< Interrupts that occurred, to be used again
+                        ///< rather than allocate new ones.
     bool inHandler;  ///< True if we are running an interrupt handler.
     bool yieldOnReturn;  ///< True if we are to context switch on return from
                          ///< the interrupt handler.
@@ -164,6 +170,9 @@ private:
     /// Check if an interrupt is supposed to occur now.
     bool CheckIfDue(bool advanceClock);
 
+    /// Put `toOccur` on `pending`, after those due no later.
+    void Insert(PendingInterrupt *toOccur);
+
     /// SetLevel, without advancing the simulated time.
     void ChangeLevel(IntStatus old,
                      IntStatus now);
@@ -45,14 +45,15 @@ CheckEndian()
 ///
 /// * `debug` -- if true, drop into the debugger after each user instruction
 ///   is executed.
-Machine::Machine(bool debug)
+/// * `numPhysPages_` -- the size of physical memory, in pages.  Pages never
+///   touched cost no memory on the host.
+Machine::Machine(bool debug, unsigned numPhysPages_)
 {
     for (unsigned i = 0; i < NUM_TOTAL_REGS; i++)
         registers[i] = 0;
 
-    mainMemory = new char[MEMORY_SIZE];
-    for (unsigned i = 0; i < MEMORY_SIZE; i++)
-          mainMemory[i] = 0;
+    numPhysPages = numPhysPages_;
+    mainMemory   = AllocZeroedArray(numPhysPages * PAGE_SIZE);
 
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLB_SIZE];
@@ -71,7 +72,7 @@ Machine::Machine(bool debug)
 /// De-allocate the data structures used to simulate user program execution.
 Machine::~Machine()
 {
-    delete [] mainMemory;
+    DeallocZeroedArray(mainMemory, numPhysPages * PAGE_SIZE);
     if (tlb != NULL)
         delete [] tlb;
 }
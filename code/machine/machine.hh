@@ -31,8 +31,8 @@
 const unsigned PAGE_SIZE = SECTOR_SIZE;  ///< Set the page size equal to the
                                          ///< disk sector size, for
                                          ///< simplicity.
-const unsigned NUM_PHYS_PAGES = 32;
-const unsigned MEMORY_SIZE = NUM_PHYS_PAGES * PAGE_SIZE;
+const unsigned NUM_PHYS_PAGES = 32;  ///< Default size of physical memory,
+                                     ///< in pages; see `-pm`.
 const unsigned TLB_SIZE = 32;  ///< if there is a TLB, make it small.
 
 enum ExceptionType {
@@ -86,8 +86,9 @@ class Instruction;
 class Machine {
 public:
 
-    /// Initialize the simulation of the hardware for running user programs.
-    Machine(bool debug);
+    /// Initialize the simulation of the hardware for running user programs,
+    /// with `numPhysPages` pages of physical memory.
+    Machine(bool debug, unsigned numPhysPages = NUM_PHYS_PAGES);
 
     /// De-allocate the data structures.
     ~Machine();
@@ -142,6 +143,7 @@ public:
 
     char *mainMemory;  ///< Physical memory to store user program,
                        ///< code and data, while executing.
+    unsigned numPhysPages;  ///< Size of `mainMemory`, in pages.
     int registers[NUM_TOTAL_REGS];  ///< CPU registers, for executing user
                                     ///< programs.
 
@@ -9,16 +9,73 @@
 
 
 #include "statistics.hh"
+#ifdef VMEM
+#include "machine.hh"
+#endif
 #include "threads/utility.hh"
 
 
+PagingStats::PagingStats()
+{
+    tlbRefills = minorFaults = majorFaults = 0;
+    swapIns = swapOuts = 0;
+    evictions = clusterEvictions = 0;
+    for (unsigned i = 0; i < FAULT_HISTOGRAM_BUCKETS; i++)
+        faultTicks[i] = 0;
+}
+
+void
+PagingStats::RecordFault(unsigned ticks)
+{
+    unsigned bucket = 0;
+
+    for (unsigned limit = FAULT_HISTOGRAM_BASE;
+         ticks >= limit && bucket < FAULT_HISTOGRAM_BUCKETS - 1; limit *= 2)
+        bucket++;
+    faultTicks[bucket]++;
+}
+
+/// Bars are scaled so that the longest one is 40 characters.
+void
+PagingStats::Print()
+{
+    unsigned most = 0;
+
+    printf("Faults: TLB refills %u, minor %u, major %u\n",
+           tlbRefills, minorFaults, majorFaults);
+    printf("Swap: pages in %u, out %u; evictions %u, %u along with"
+           " neighbours\n", swapIns, swapOuts, evictions, clusterEvictions);
+    for (unsigned i = 0; i < FAULT_HISTOGRAM_BUCKETS; i++)
+        if (faultTicks[i] > most)
+            most = faultTicks[i];
+    if (most == 0)
+        return;
+    printf("Fault service time, in ticks:\n");
+    for (unsigned i = 0, low = 0, high = FAULT_HISTOGRAM_BASE;
+         i < FAULT_HISTOGRAM_BUCKETS; i++, low = high, high *= 2) {
+        if (i < FAULT_HISTOGRAM_BUCKETS - 1)
+            printf("  %6u-%-6u %8u ", low, high - 1, faultTicks[i]);
+        else
+            printf("  %6u+      %8u ", low, faultTicks[i]);
+        for (unsigned bar = (faultTicks[i] * 40 + most - 1) / most; bar > 0;
+             bar--)
+            putchar('#');
+        putchar('\n');
+    }
+}
+
 /// Initialize performance metrics to zero, at system startup.
 Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    diskBusyTicks = diskActiveTicks = diskSeekTracks = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numSwapCompressed = swapCompressedBytes = 0;
+    numSwapCacheHits = numSwapCacheMisses = 0;
+    numSwapDiskWrites = numSwapWritebacks = 0;
+    numSwapReadRequests = numSwapWriteRequests = 0;
     numAccesses = numMisses = 0;
 #ifdef DFS_TICKS_FIX
     tickResets = 0;
@@ -38,10 +95,33 @@ Statistics::Print()
 #endif
     printf("Ticks: total %u, idle %u, system %u, user %u\n",
            totalTicks, idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %u, writes %u\n", numDiskReads, numDiskWrites);
+    printf("Disk I/O: reads %u, writes %u, seeks across %u tracks\n",
+           numDiskReads, numDiskWrites, diskSeekTracks);
+    if (diskActiveTicks > 0)
+        printf("Disk throughput: %.2f sectors per 1000 ticks,"
+               " %.2f spindles busy on average\n",
+               (numDiskReads + numDiskWrites) * 1000.0 / diskActiveTicks,
+               (float) diskBusyTicks / diskActiveTicks);
     printf("Console I/O: reads %u, writes %u\n",
            numConsoleCharsRead, numConsoleCharsWritten);
     printf("Paging: faults %u\n", numPageFaults);
+    if (paging.tlbRefills + paging.minorFaults + paging.majorFaults > 0)
+        paging.Print();
+#ifdef VMEM
+    if (numSwapCompressed > 0)
+        printf("Swap cache: %u pages compressed to %.1f%%, hit ratio %.2f%%,"
+               " saved %u page reads and %u page writes\n",
+               numSwapCompressed,
+               swapCompressedBytes * 100.0 / (numSwapCompressed * PAGE_SIZE),
+               numSwapCacheHits * 100.0
+                 / (numSwapCacheHits + numSwapCacheMisses),
+               numSwapCacheHits, numSwapCompressed - numSwapWritebacks);
+    if (numSwapReadRequests + numSwapWriteRequests > 0)
+        printf("Swap I/O: %u pages read in %u requests,"
+               " %u pages written in %u requests\n",
+               numSwapCacheMisses, numSwapReadRequests,
+               numSwapDiskWrites, numSwapWriteRequests);
+#endif
     printf("Network I/O: packets received %u, sent %u\n",
            numPacketsRecvd, numPacketsSent);
     if(numAccesses > 0)
@@ -11,6 +11,52 @@
 #define NACHOS_MACHINE_STATS__HH
 
 
+/// Buckets in the histogram of fault service times.  The first one counts
+/// faults served in less than `FAULT_HISTOGRAM_BASE` ticks, each one after
+/// it faults taking up to twice as long as the one before, and the last one
+/// every fault taking longer.
+const unsigned FAULT_HISTOGRAM_BUCKETS = 12;
+const unsigned FAULT_HISTOGRAM_BASE    = 16;
+
+/// Paging counters, kept for the whole system and for each address space.
+///
+/// The fields are all unsigned words, in the order of `PagingInfo` in
+/// `syscall.h`: `GetStats` copies them to user programs word by word.
+class PagingStats {
+public:
+
+    /// Faults on pages in memory, that were only missing from the TLB.
+    unsigned tlbRefills;
+
+    /// Faults served without reading anything: zero filled pages, text
+    /// loaded by another process, and copies on write.
+    unsigned minorFaults;
+
+    /// Faults that read the page, from the executable or from swap.
+    unsigned majorFaults;
+
+    /// Pages read back from swap, and written to it.
+    unsigned swapIns;
+    unsigned swapOuts;
+
+    /// Pages taken away by the pageout daemon, and how many of them only
+    /// went along with a neighbour chosen by the replacement policy.
+    unsigned evictions;
+    unsigned clusterEvictions;
+
+    /// Minor and major faults, by the ticks it took to serve them.
+    unsigned faultTicks[FAULT_HISTOGRAM_BUCKETS];
+
+    /// Initialize everything to zero.
+    PagingStats();
+
+    /// Count a fault served in `ticks`, in the histogram.
+    void RecordFault(unsigned ticks);
+
+    /// Print the counters, and the histogram as bars.
+    void Print();
+};
+
 /// The following class defines the statistics that are to be kept about
 /// Nachos behavior -- how much time (ticks) elapsed, how many user
 /// instructions executed, etc.
@@ -38,6 +84,16 @@ public:
     /// Number of disk write requests.
     unsigned numDiskWrites;
 
+    /// Time spent serving disk requests, added over all the spindles.
+    unsigned diskBusyTicks;
+
+    /// Time during which at least one spindle was busy.
+    unsigned diskActiveTicks;
+
+    /// Number of tracks the disk heads moved across, added over all the
+    /// spindles.
+    unsigned diskSeekTracks;
+
     /// Number of characters read from the keyboard.
     unsigned numConsoleCharsRead;
 
@@ -47,6 +103,25 @@ public:
     /// Number of virtual memory page faults.
     unsigned numPageFaults;
 
+    /// Pages kept in the compressed swap cache, and their total size once
+    /// compressed.
+    unsigned numSwapCompressed;
+    unsigned swapCompressedBytes;
+
+    /// Pages read back from swap: found in the compressed cache, or read
+    /// from the swap file.
+    unsigned numSwapCacheHits;
+    unsigned numSwapCacheMisses;
+
+    /// Pages written to the swap file, and how many of them were moved
+    /// there from the compressed cache.
+    unsigned numSwapDiskWrites;
+    unsigned numSwapWritebacks;
+
+    /// Requests made to the swap file: each moves a run of pages.
+    unsigned numSwapReadRequests;
+    unsigned numSwapWriteRequests;
+
     /// Number of packets sent over the network.
     unsigned numPacketsSent;
 
@@ -59,6 +134,9 @@ public:
     /// Number of TLB misses
     unsigned numMisses;
 
+    /// Paging counters for the whole system.
+    PagingStats paging;
+
 #ifdef DFS_TICKS_FIX
     /// Number of times the tick count gets reset.
     unsigned long tickResets;
@@ -35,6 +35,7 @@ extern "C" {
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/file.h>
+#include <sys/stat.h>
 #include <sys/un.h>
 #include <sys/mman.h>
 #ifdef HOST_i386
@@ -184,6 +185,32 @@ Close(int fd)
     ASSERT(retVal >= 0);
 }
 
+/// Return a new file descriptor for the same open file.
+///
+/// Abort on error.
+int
+Duplicate(int fd)
+{
+    int newFd = dup(fd);
+
+    ASSERT(newFd >= 0);
+    return newFd;
+}
+
+/// Return the number that identifies the file open as `fd` in its file
+/// system.
+///
+/// Abort on error.
+unsigned
+Inode(int fd)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+
+    ASSERT(retVal >= 0);
+    return buf.st_ino;
+}
+
 /// Delete a file.
 bool
 Unlink(const char *name)
@@ -382,3 +409,79 @@ DeallocBoundedArray(const char *ptr, int size)
 #endif
     delete [] (ptr - pgSize);
 }
+
+/// Allocate an array of zeros with an anonymous mapping.  The host only
+/// gives it a page of memory on the first write to it, so huge arrays that
+/// are mostly untouched are cheap.
+///
+/// * `size` is the amount of space needed (in bytes).
+char *
+AllocZeroedArray(unsigned size)
+{
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+    return (char *) ptr;
+}
+
+/// Deallocate an array allocated with `AllocZeroedArray`.
+///
+/// * `ptr` is the array to be deallocated.
+/// * `size` is the size it was allocated with (in bytes).
+void
+DeallocZeroedArray(char *ptr, unsigned size)
+{
+    munmap(ptr, size);
+}
+
+/// Allocate an execution stack with an anonymous mapping.  The page right
+/// below it is made inaccessible, so that running off the end of the stack
+/// faults at once, rather than overwriting whatever lies next to it.  As
+/// with `AllocZeroedArray`, the host only gives memory to the pages that
+/// are touched, which for most stacks are a few at the top.
+///
+/// * `size` is the amount of space needed (in bytes), a multiple of the
+///   page size.
+char *
+AllocStack(unsigned size)
+{
+    unsigned pgSize = getpagesize();
+    char *ptr = (char *) mmap(NULL, size + pgSize, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                              -1, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+    int status = mprotect(ptr, pgSize, PROT_NONE);
+    ASSERT(status == 0);
+    return ptr + pgSize;
+}
+
+/// Deallocate a stack allocated with `AllocStack`, guard page included.
+///
+/// * `ptr` is the stack to be deallocated.
+/// * `size` is the size it was allocated with (in bytes).
+void
+DeallocStack(char *ptr, unsigned size)
+{
+    unsigned pgSize = getpagesize();
+
+    munmap(ptr - pgSize, size + pgSize);
+}
+
+/// Let the host reclaim the memory of the pages of a stack allocated with
+/// `AllocStack`, but for those holding its top `keep` bytes.  The stack
+/// stays mapped: the pages released read as zeros when touched again.
+///
+/// * `ptr` is the stack.
+/// * `size` is the size it was allocated with (in bytes).
+/// * `keep` is the amount of space at the top to leave alone (in bytes).
+void
+ReleaseStack(char *ptr, unsigned size, unsigned keep)
+{
+    unsigned pgSize = getpagesize();
+
+    if (keep >= size)
+        return;
+    madvise(ptr, (size - keep) / pgSize * pgSize, MADV_DONTNEED);
+}
@@ -39,6 +39,10 @@ extern int Tell(int fd);
 
 extern void Close(int fd);
 
+extern int Duplicate(int fd);
+
+extern unsigned Inode(int fd);
+
 extern bool Unlink(const char *name);
 
 /// Interprocess communication operations, for simulating the network.
@@ -82,6 +86,21 @@ extern char *AllocBoundedArray(int size);
 
 extern void DeallocBoundedArray(const char *p, int size);
 
+/// Allocate, de-allocate an array of zeros, such that the host only gives
+/// it memory as it is touched.
+extern char *AllocZeroedArray(unsigned size);
+
+extern void DeallocZeroedArray(char *p, unsigned size);
+
+/// Allocate, de-allocate an execution stack, with an inaccessible guard
+/// page below it, such that the host only gives it memory as it is touched.
+extern char *AllocStack(unsigned size);
+
+extern void DeallocStack(char *p, unsigned size);
+
+/// Give the host back the memory of a stack, but for its top `keep` bytes.
+extern void ReleaseStack(char *p, unsigned size, unsigned keep);
+
 /// Other C library routines that are used by Nachos.
 /// These are assumed to be portable, so we do not include a wrapper.
 extern "C" {
@@ -246,15 +246,15 @@ Machine::Translate(unsigned virtAddr, unsigned *physAddr,
 
     // If the `pageFrame` is too big, there is something really wrong!  An
     // invalid translation was loaded into the page table or TLB.
-    if (pageFrame >= NUM_PHYS_PAGES) {
-        DEBUG('a', "*** frame %u > %u!\n", pageFrame, NUM_PHYS_PAGES);
+    if (pageFrame >= numPhysPages) {
+        DEBUG('a', "*** frame %u > %u!\n", pageFrame, numPhysPages);
         return BUS_ERROR_EXCEPTION;
     }
     entry->use = true;  // Set the `use`, `dirty` bits.
     if (writing)
         entry->dirty = true;
     *physAddr = pageFrame * PAGE_SIZE + offset;
-    ASSERT(*physAddr >= 0 && *physAddr + size <= MEMORY_SIZE);
+    ASSERT(*physAddr >= 0 && *physAddr + size <= numPhysPages * PAGE_SIZE);
     DEBUG('a', "phys addr = 0x%X\n", *physAddr);
     return NO_EXCEPTION;
 }
@@ -0,0 +1,57 @@
+// Programa de testeo fork: un pool de procesos que comparten la memoria del
+// padre hasta que escriben en ella.
+
+#include "syscall.h"
+
+#define NWORKERS 4
+#define NITEMS   256
+
+int data[NITEMS];
+
+static void
+Print(char *s)
+{
+    int n;
+
+    for(n = 0; s[n] != '\0'; n++)
+        ;
+    Write(s, n, ConsoleOutput);
+}
+
+int
+main(void)
+{
+    SpaceId workers[NWORKERS];
+    int i, w;
+
+    for(i = 0; i < NITEMS; i++)
+        data[i] = i;
+
+    for(w = 0; w < NWORKERS; w++){
+        workers[w] = Fork();
+        if(workers[w] == 0){
+            // Cada hijo modifica solo su parte del arreglo.
+            for(i = w; i < NITEMS; i += NWORKERS)
+                data[i] = -1;
+            for(i = 0; i < NITEMS; i++)
+                if(data[i] != (i % NWORKERS == w ? -1 : i)){
+                    Print("fork: BAD child\n");
+                    Exit(1);
+                }
+            Print("fork: child ok\n");
+            Exit(0);
+        }
+    }
+
+    for(w = 0; w < NWORKERS; w++)
+        Join(workers[w]);
+
+    // El padre no debe ver las escrituras de los hijos.
+    for(i = 0; i < NITEMS; i++)
+        if(data[i] != i){
+            Print("fork: BAD parent\n");
+            Halt();
+        }
+    Print("fork: parent ok\n");
+    Halt();
+}
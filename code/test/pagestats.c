@@ -0,0 +1,75 @@
+// Programa de testeo pagestats: toca páginas nuevas del heap y muestra los
+// contadores de paginación del proceso y del sistema.
+
+#include "syscall.h"
+
+#define PAGES 32
+
+static void
+Print(char *s)
+{
+    int n;
+
+    for(n = 0; s[n] != '\0'; n++)
+        ;
+    Write(s, n, ConsoleOutput);
+}
+
+static void
+PrintNumber(unsigned n)
+{
+    char buf[12];
+    int i = 11;
+
+    buf[i] = '\0';
+    do{
+        buf[--i] = '0' + n % 10;
+        n /= 10;
+    }while(n > 0);
+    Print(&buf[i]);
+}
+
+static void
+Show(char *who, PagingInfo *info)
+{
+    Print(who);
+    Print(": refills ");
+    PrintNumber(info->tlbRefills);
+    Print(", minor ");
+    PrintNumber(info->minorFaults);
+    Print(", major ");
+    PrintNumber(info->majorFaults);
+    Print(", swap in ");
+    PrintNumber(info->swapIns);
+    Print(", out ");
+    PrintNumber(info->swapOuts);
+    Print("\n");
+}
+
+int
+main(void)
+{
+    PagingInfo before, after, system;
+    char *heap;
+    int i;
+
+    GetStats(&before, 0);
+    heap = (char *) Sbrk(PAGES * 128);
+    if((int) heap == -1){
+        Print("pagestats: BAD grow\n");
+        Halt();
+    }
+    // Cada página nueva del heap es una falla menor al menos.
+    for(i = 0; i < PAGES; i++)
+        heap[i * 128] = i;
+    GetStats(&after, &system);
+    Show("process", &after);
+    Show("system", &system);
+    if(after.minorFaults - before.minorFaults < PAGES
+          || system.minorFaults < after.minorFaults){
+        Print("pagestats: BAD counts\n");
+        Halt();
+    }
+    Print("pagestats: ok\n");
+    Halt();
+}
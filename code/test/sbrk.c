@@ -0,0 +1,77 @@
+// Programa de testeo sbrk: hace crecer el heap de a pedazos, lo usa de forma
+// salteada, lo achica, y hace crecer la pila con una recursión profunda.
+
+#include "syscall.h"
+
+#define CHUNK   (64 * 1024)
+#define NCHUNKS 8
+#define DEPTH   200
+
+static void
+Print(char *s)
+{
+    int n;
+
+    for(n = 0; s[n] != '\0'; n++)
+        ;
+    Write(s, n, ConsoleOutput);
+}
+
+// Cada nivel ocupa algo más de un marco de pila.
+static int
+Deep(int n)
+{
+    int frame[40];
+    int i;
+
+    for(i = 0; i < 40; i++)
+        frame[i] = n + i;
+    if(n == 0)
+        return frame[39];
+    return Deep(n - 1) + frame[1] - n;
+}
+
+int
+main(void)
+{
+    char *chunks[NCHUNKS];
+    int i, c;
+
+    for(c = 0; c < NCHUNKS; c++){
+        chunks[c] = (char *) Sbrk(CHUNK);
+        if((int) chunks[c] == -1){
+            Print("sbrk: BAD grow\n");
+            Halt();
+        }
+    }
+
+    // Solo se tocan unas pocas páginas de cada pedazo.
+    for(c = 0; c < NCHUNKS; c++)
+        for(i = 0; i < CHUNK; i += 8 * 1024)
+            if(chunks[c][i] != 0){
+                Print("sbrk: BAD not zero\n");
+                Halt();
+            }else
+                chunks[c][i] = c + 1;
+    for(c = 0; c < NCHUNKS; c++)
+        for(i = 0; i < CHUNK; i += 8 * 1024)
+            if(chunks[c][i] != c + 1){
+                Print("sbrk: BAD heap\n");
+                Halt();
+            }
+
+    // Al achicar y volver a crecer, la memoria vuelve en cero.
+    Sbrk(-CHUNK);
+    if((char *) Sbrk(CHUNK) != chunks[NCHUNKS - 1]
+          || chunks[NCHUNKS - 1][0] != 0){
+        Print("sbrk: BAD shrink\n");
+        Halt();
+    }
+
+    if(Deep(DEPTH) != DEPTH + 39){
+        Print("sbrk: BAD stack\n");
+        Halt();
+    }
+    Print("sbrk: ok\n");
+    Halt();
+}
@@ -115,6 +115,14 @@ Fork:
         j       $31
         .end    Fork
 
+        .globl  Sbrk
+        .ent    Sbrk
+Sbrk:
+        addiu   $2, $0, SC_Sbrk
+        syscall
+        j       $31
+        .end    Sbrk
+
         .globl  Yield
         .ent    Yield
 Yield:
@@ -123,6 +131,22 @@ Yield:
         j       $31
         .end    Yield
 
+        .globl  SetTickets
+        .ent    SetTickets
+SetTickets:
+        addiu   $2, $0, SC_SetTickets
+        syscall
+        j       $31
+        .end    SetTickets
+
+        .globl  GetStats
+        .ent    GetStats
+GetStats:
+        addiu   $2, $0, SC_GetStats
+        syscall
+        j       $31
+        .end    GetStats
+
 /// Dummy function to keep gcc happy.
         .globl  __main
         .ent    __main
@@ -0,0 +1,33 @@
+// Programa de testeo stride: tres hijos con 100, 200 y 400 tickets hacen el
+// mismo trabajo.  Con -stride el de más tickets debería terminar primero:
+// cada uno escribe su número al terminar.
+
+#include "syscall.h"
+
+#define CHILDREN 3
+#define WORK     200000
+
+int
+main(void)
+{
+    SpaceId children[CHILDREN];
+    int c, i, tickets;
+    volatile int sum;
+    char digit;
+
+    for(c = 0, tickets = 100; c < CHILDREN; c++, tickets *= 2){
+        children[c] = Fork();
+        if(children[c] == 0){
+            SetTickets(tickets);
+            for(i = 0, sum = 0; i < WORK; i++)
+                sum += i;
+            digit = '1' + c;
+            Write(&digit, 1, ConsoleOutput);
+            Exit(0);
+        }
+    }
+    for(c = 0; c < CHILDREN; c++)
+        Join(children[c]);
+    Write("\n", 1, ConsoleOutput);
+    Halt();
+}
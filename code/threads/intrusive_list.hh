@@ -0,0 +1,129 @@
+/// Data structures to manage lists linked through their items.
+///
+/// Unlike `List`, that allocates a `ListElement` for each item it holds,
+/// an `IntrusiveList` keeps the link in the item itself: putting items in
+/// and taking them out allocates nothing, which is what the queues of
+/// threads and of pending interrupts need.  In exchange, an item can only
+/// be on one list at a time for each link it has.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_INTRUSIVELIST__HH
+#define NACHOS_THREADS_INTRUSIVELIST__HH
+
+
+#include "utility.hh"
+
+
+/// A singly linked list of `Item`s, linked through their member `NEXT`,
+/// that is `NULL` in the last one.
+template <class Item, Item *Item::*NEXT>
+class IntrusiveList {
+public:
+
+    /// Initialize the list, empty.
+    IntrusiveList();
+
+    /// Is the list empty?
+    bool IsEmpty()
+    {
+        return first == NULL;
+    }
+
+    /// First item on the list, `NULL` if it is empty.
+    Item *First()
+    {
+        return first;
+    }
+
+    /// Item after `item`, `NULL` if it is the last.
+    static Item *Next(Item *item)
+    {
+        return item->*NEXT;
+    }
+
+    /// Put `item` at the end of the list.
+    void Append(Item *item);
+
+    /// Put `item` at the beginning of the list.
+    void Prepend(Item *item);
+
+    /// Put `item` right after `prev`, that must be on the list, or at the
+    /// beginning if `prev` is `NULL`.
+    void InsertAfter(Item *prev, Item *item);
+
+    /// Take the first item off the list, and return it; `NULL` if there is
+    /// none.
+    Item *Remove();
+
+    /// Apply `func` to all items in the list.
+    void Apply(void (*func)(Item *));
+
+private:
+    Item *first;  ///< Head of the list, `NULL` if list is empty.
+    Item *last;   ///< Last item of list.
+};
+
+template <class Item, Item *Item::*NEXT>
+IntrusiveList<Item, NEXT>::IntrusiveList()
+{
+    first = last = NULL;
+}
+
+template <class Item, Item *Item::*NEXT>
+void
+IntrusiveList<Item, NEXT>::Append(Item *item)
+{
+    InsertAfter(last, item);
+}
+
+template <class Item, Item *Item::*NEXT>
+void
+IntrusiveList<Item, NEXT>::Prepend(Item *item)
+{
+    InsertAfter(NULL, item);
+}
+
+template <class Item, Item *Item::*NEXT>
+void
+IntrusiveList<Item, NEXT>::InsertAfter(Item *prev, Item *item)
+{
+    if (prev == NULL) {
+        item->*NEXT = first;
+        first = item;
+    } else {
+        item->*NEXT = prev->*NEXT;
+        prev->*NEXT = item;
+    }
+    if (item->*NEXT == NULL)
+        last = item;
+}
+
+template <class Item, Item *Item::*NEXT>
+Item *
+IntrusiveList<Item, NEXT>::Remove()
+{
+    Item *item = first;
+
+    if (item != NULL) {
+        first = item->*NEXT;
+        if (first == NULL)
+            last = NULL;
+        item->*NEXT = NULL;
+    }
+    return item;
+}
+
+template <class Item, Item *Item::*NEXT>
+void
+IntrusiveList<Item, NEXT>::Apply(void (*func)(Item *))
+{
+    for (Item *item = first; item != NULL; item = item->*NEXT)
+        func(item);
+}
+
+
+#endif
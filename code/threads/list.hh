@@ -20,6 +20,11 @@
 ///
 /// Internal data structures kept public so that `List` operations can access
 /// them directly.
+///
+/// Elements are not given back to the heap: they wait in a pool, one for
+/// each type of item, for the next list to need one.  So lists only
+/// allocate while they hold more items than they ever did.  See also
+/// `IntrusiveList`, that allocates nothing at all.
 template <class Item>
 class ListElement {
 public:
@@ -27,9 +32,18 @@ public:
     // Initialize a list element.
     ListElement(Item itemPtr, int sortKey);
 
+    /// Take an element from the pool, or from the heap if it is empty.
+    static void *operator new(size_t size);
+
+    /// Put an element in the pool.
+    static void operator delete(void *p);
+
     ListElement *next;  ///< Next element on list, NULL if this is the last.
     int key;            ///< Priority, for a sorted list.
     Item item;          ///< Item on the list.
+
+private:
+    static ListElement *pool;  ///< Free elements, linked through `next`.
 };
 
 /// The following class defines a “list” -- a singly linked list of list
@@ -90,6 +104,31 @@ ListElement<Item>::ListElement(Item anItem, int sortKey)
      next = NULL;  // Assume we will put it at the end of the list.
 }
 
+template <class Item>
+ListElement<Item> *ListElement<Item>::pool = NULL;
+
+template <class Item>
+void *
+ListElement<Item>::operator new(size_t size)
+{
+    ASSERT(size == sizeof (ListElement));
+    if (pool == NULL)
+        return ::operator new(size);
+
+    ListElement *element = pool;
+    pool = element->next;
+    return element;
+}
+
+template <class Item>
+void
+ListElement<Item>::operator delete(void *p)
+{
+    ListElement *element = (ListElement *) p;
+    element->next = pool;
+    pool = element;
+}
+
 /// Initialize a list, empty to start with.
 ///
 /// Elements can now be added to the list.
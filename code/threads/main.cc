@@ -10,10 +10,14 @@
 /// Usage
 /// =====
 ///
-///     nachos -d <debugflags> -rs <random seed #>
+///     nachos -d <debugflags> -rs <random seed #> -mlfq <quanta> -stride
+///            -sb
 ///            -s -x <nachos file> -c <consoleIn> <consoleOut>
-///            -f -cp <unix file> <nachos file>
+///            -pm <number of frames> -rp <replacement policy>
+///            -sc <swap cache pages>
+///            -f -nd <number of disks> -cp <unix file> <nachos file>
 ///            -p <nachos file> -r <nachos file> -l -D -t
+///            -fb <workload> -df -fr
 ///            -n <network reliability> -m <machine id>
 ///            -o <other machine id>
 ///            -z
@@ -24,6 +28,16 @@
 /// * `-d` -- causes certain debugging messages to be printed (cf.
 ///   `utility.hh`).
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
+/// * `-mlfq` -- schedules with a multilevel feedback queue, given the
+///   quantum of each level in ticks, from the top: `-mlfq 100,200,400`.
+///   The time each thread took to first run and to finish is printed as it
+///   finishes.
+/// * `-stride` -- shares the processor among threads of a priority in
+///   proportion to their tickets, instead of in turns; times are printed
+///   as with `-mlfq`.
+/// * `-sb` -- runs a scheduling benchmark: threads with 100, 200 and 400
+///   tickets spin, and the share of the processor each got is printed as
+///   time goes by.
 /// * `-z` -- prints version and copyright information, and exits.
 ///
 /// *USER_PROGRAM* options
@@ -32,17 +46,33 @@
 /// * `-s` -- causes user programs to be executed in single-step mode.
 /// * `-x` -- runs a user program.
 /// * `-c` -- tests the console.
+/// * `-pm` -- sets the size of physical memory, in frames (32 by default).
+///   Frames cost no memory on the host until they are used.
+///
+/// *VMEM* options
+/// --------------
+///
+/// * `-rp` -- picks the page replacement policy: `fifo`, `clock`, `eclock`
+///   (the default), `aging` or `wsclock`.
+/// * `-sc` -- sets the size of the compressed swap cache, in pages (8 by
+///   default); 0 sends every page straight to the swap file.
 ///
 /// *FILESYS* options
 /// -----------------
 ///
 /// * `-f` -- causes the physical disk to be formatted.
+/// * `-nd` -- stripes the disk across this many spindles (`DISK`,
+///   `DISK.1`, ...); must match the number used when formatting.
 /// * `-cp` -- copies a file from UNIX to Nachos.
 /// * `-p` -- prints a Nachos file to stdout.
 /// * `-r` -- removes a Nachos file from the file system.
 /// * `-l` -- lists the contents of the Nachos directory.
 /// * `-D` -- prints the contents of the entire file system.
 /// * `-t` -- tests the performance of the Nachos file system.
+/// * `-fb` -- runs a file system benchmark workload (`all` runs every one
+///   of them; see `fs_test.cc`).
+/// * `-df` -- starts defragmenting the disk, in a background thread.
+/// * `-fr` -- prints a report on how fragmented the files are.
 ///
 /// *NETWORK* options
 /// -----------------
@@ -71,9 +101,11 @@
 // External functions used by this file.
 
 void ThreadTest();
+void SchedulerBenchmark();
 void Copy(const char *unixFile, const char *nachosFile);
 void Print(const char *file);
 void PerformanceTest(void);
+void FileSystemBenchmark(const char *name);
 void StartProcess(const char *file);
 void ConsoleTest(const char *in, const char *out);
 void MailTest(int networkID);
@@ -110,7 +142,8 @@ main(int argc, char **argv)
         if (!strcmp(*argv, "-z")) {         // Print version info and exit.
             PrintVersion();
             return 0;
-        }
+        } else if (!strcmp(*argv, "-sb"))   // Scheduling benchmark.
+            SchedulerBenchmark();
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {         // Run a user program.
             ASSERT(argc > 1);
@@ -148,6 +181,14 @@ main(int argc, char **argv)
             fileSystem->Print();
         else if (!strcmp(*argv, "-t"))      // Performance test.
             PerformanceTest();
+        else if (!strcmp(*argv, "-fb")) {   // Benchmark workloads.
+            ASSERT(argc > 1);
+            FileSystemBenchmark(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-df"))   // Defragment.
+            fileSystem->StartDefragmenter();
+        else if (!strcmp(*argv, "-fr"))     // Fragmentation report.
+            fileSystem->FragmentationReport();
 #endif
 #ifdef NETWORK
         if (!strcmp(*argv, "-o")) {
@@ -9,8 +9,7 @@
 /// needed to wait for a lock, and the lock was busy, we would end up calling
 /// `FindNextToRun`, and that would put us in an infinite loop.
 ///
-/// Very simple implementation -- no priorities, straight FIFO.  Might need
-/// to be improved in later assignments.
+/// Strict priorities, FIFO within each one.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -22,17 +21,38 @@
 #include "system.hh"
 
 
+/// Ticks the processor was busy so far.
+static inline unsigned
+BusyTicks()
+{
+    return stats->userTicks + stats->systemTicks;
+}
+
+/// Number of the highest bit set in `x`, that must not be zero.
+static inline unsigned
+HighestBit(unsigned x)
+{
+    return 31 - __builtin_clz(x);
+}
+
 /// Initialize the list of ready but not running threads to empty.
 Scheduler::Scheduler()
 {
-    readyList = new List<Thread*>[SCHEDULER_PRIORITY_NUMBER];
+    for (unsigned p = 0; p < SCHEDULER_PRIORITY_NUMBER; p++)
+        readyQueue[p].first = readyQueue[p].last = NULL;
+    for (unsigned w = 0; w < NUM_WORDS; w++)
+        nonEmpty[w] = 0;
+    nonEmptyWords = 0;
+    numLevels     = 0;
+    epoch         = 0;
+    lastBoost     = 0;
+    stride        = false;
+    minPass       = 0;
 }
 
-/// De-allocate the list of ready threads.
+/// The threads belong to whoever created them: there is nothing to free.
 Scheduler::~Scheduler()
-{
-    delete [] readyList;
-}
+{}
 
 /// Mark a thread as ready, but not running.
 /// Put it on the ready list, for later scheduling onto the CPU.
@@ -43,11 +63,19 @@ Scheduler::ReadyToRun(Thread *thread)
 {
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
+    if (thread->status == RUNNING)
+        Charge(thread);
+    else {
+        Refresh(thread);
+        if (thread->pass < minPass)
+            thread->pass = minPass;
+    }
     thread->setStatus(READY);
-    (readyList[thread->getPriority()]).Append(thread);
+    Enqueue(thread);
 }
 
-/// Return the next thread to be scheduled onto the CPU.
+/// Return the next thread to be scheduled onto the CPU: the first one of
+/// the highest priority.
 ///
 /// If there are no ready threads, return `NULL`.
 ///
@@ -55,13 +83,239 @@ Scheduler::ReadyToRun(Thread *thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-    //return readyList->Remove();
-    int i;
-    for (i=(SCHEDULER_PRIORITY_NUMBER-1); i>=0; i--){
-        if (!readyList[i].IsEmpty())
-            return readyList[i].Remove();
+    Boost();
+    if (nonEmptyWords == 0)
+        return NULL;
+
+    unsigned w = HighestBit(nonEmptyWords);
+    Thread *thread = readyQueue[w * WORD_BITS + HighestBit(nonEmpty[w])].first;
+    Dequeue(thread);
+    return thread;
+}
+
+void
+Scheduler::ChangePriority(Thread *thread, int priority)
+{
+    Dequeue(thread);
+    thread->priority = priority;
+    Enqueue(thread);
+}
+
+void
+Scheduler::Enqueue(Thread *thread)
+{
+    unsigned p = thread->priority;
+    ASSERT(p < SCHEDULER_PRIORITY_NUMBER);
+    Queue *queue = &readyQueue[p];
+
+    // In order of pass, after those with the same: from the back, as the
+    // thread that just ran tends to have the highest.
+    Thread *prev = queue->last;
+    if (stride)
+        while (prev != NULL && prev->pass > thread->pass)
+            prev = prev->prevReady;
+    Thread *next = prev != NULL ? prev->nextReady : queue->first;
+
+    thread->prevReady = prev;
+    thread->nextReady = next;
+    if (prev != NULL)
+        prev->nextReady = thread;
+    else
+        queue->first = thread;
+    if (next != NULL)
+        next->prevReady = thread;
+    else
+        queue->last = thread;
+    nonEmpty[p / WORD_BITS] |= 1u << p % WORD_BITS;
+    nonEmptyWords           |= 1u << p / WORD_BITS;
+}
+
+void
+Scheduler::Dequeue(Thread *thread)
+{
+    unsigned p = thread->priority;
+    Queue *queue = &readyQueue[p];
+
+    if (thread->prevReady != NULL)
+        thread->prevReady->nextReady = thread->nextReady;
+    else
+        queue->first = thread->nextReady;
+    if (thread->nextReady != NULL)
+        thread->nextReady->prevReady = thread->prevReady;
+    else
+        queue->last = thread->prevReady;
+    thread->nextReady = thread->prevReady = NULL;
+
+    if (queue->first == NULL) {
+        nonEmpty[p / WORD_BITS] &= ~(1u << p % WORD_BITS);
+        if (nonEmpty[p / WORD_BITS] == 0)
+            nonEmptyWords &= ~(1u << p / WORD_BITS);
+    }
+}
+
+void
+Scheduler::UseMultilevel(const char *list)
+{
+    numLevels = 0;
+    for (const char *s = list; *s != '\0'; ) {
+        char *end;
+        ASSERT(numLevels < MLFQ_MAX_LEVELS);
+        quanta[numLevels] = strtoul(s, &end, 10);
+        ASSERT(end != s && quanta[numLevels] > 0);
+        numLevels++;
+        s = *end == ',' ? end + 1 : end;
+        ASSERT(*end == ',' || *end == '\0');
+    }
+    ASSERT(numLevels > 0 && !stride);
+    lastBoost = stats->totalTicks;
+}
+
+/// Threads made ready so far are in no order of pass, but all have the same
+/// one, so there is nothing to sort.
+void
+Scheduler::UseStride()
+{
+    ASSERT(numLevels == 0);
+    stride = true;
+}
+
+bool
+Scheduler::ShouldPreempt()
+{
+    if (numLevels == 0)
+        return true;
+
+    bool over = Charge(currentThread);
+    Boost();
+    return over || (nonEmptyWords != 0
+                     && HighestBit(nonEmptyWords) * WORD_BITS
+                        + HighestBit(nonEmpty[HighestBit(nonEmptyWords)])
+                        > (unsigned) currentThread->priority);
+}
+
+/// The quantum starts over, so that a thread that does little between
+/// waits keeps climbing.
+void
+Scheduler::BlocksOnIO(Thread *thread)
+{
+    if (numLevels == 0)
+        return;
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Charge(thread);
+    thread->sliceUsed = 0;
+    if (thread->level > 0)
+        SetLevel(thread, thread->level - 1);
+    interrupt->SetLevel(oldLevel);
+}
+
+int
+Scheduler::BasePriority(Thread *thread)
+{
+    int priority = thread->originalPriority;
+
+    if (numLevels > 0 && priority != BACKGROUND_PRIORITY)
+        priority += numLevels - 1 - thread->level;
+    return priority < SCHEDULER_PRIORITY_NUMBER
+           ? priority : SCHEDULER_PRIORITY_NUMBER - 1;
+}
+
+void
+Scheduler::PrintTimes(Thread *thread)
+{
+    Charge(thread);
+    unsigned now     = stats->totalTicks;
+    unsigned started = thread->firstRun != -1
+                       ? (unsigned) thread->firstRun : thread->arrival;
+    printf("Thread \"%s\": response %u, turnaround %u, ran %u ticks",
+           thread->getName(), started - thread->arrival,
+           now - thread->arrival, thread->ticksRun);
+    if (stride)
+        printf(", tickets %u\n", thread->tickets);
+    else
+        printf(", level %u\n", thread->level);
+}
+
+/// The whole time the processor was busy since the thread was dispatched is
+/// charged to it, even interrupt handling, as the timer does not tell
+/// either.  Idle time is not: the thread was waiting then.
+bool
+Scheduler::Charge(Thread *thread)
+{
+    unsigned now = BusyTicks();
+    unsigned ran = now - thread->dispatched;
+
+    thread->dispatched = now;
+    thread->ticksRun  += ran;
+    if (stride)
+        thread->pass += (unsigned long long) ran
+                        * (STRIDE_ONE / thread->tickets);
+    if (numLevels == 0)
+        return false;
+
+    Refresh(thread);
+    thread->sliceUsed += ran;
+    if (thread->sliceUsed < quanta[thread->level])
+        return false;
+    thread->sliceUsed = 0;
+    if (thread->level + 1 < numLevels)
+        SetLevel(thread, thread->level + 1);
+    return true;
+}
+
+/// A priority lent by a lock waiter is left alone: the lock holder gets its
+/// base priority back when it releases the lock.
+void
+Scheduler::SetLevel(Thread *thread, unsigned level)
+{
+    bool lent = thread->priority != BasePriority(thread);
+
+    DEBUG('t', "Thread \"%s\" goes to level %u.\n", thread->getName(), level);
+    thread->level = level;
+    if (!lent)
+        thread->priority = BasePriority(thread);
+}
+
+void
+Scheduler::Refresh(Thread *thread)
+{
+    if (numLevels == 0 || thread->boostEpoch == epoch)
+        return;
+    thread->boostEpoch = epoch;
+    thread->sliceUsed  = 0;
+    SetLevel(thread, 0);
+}
+
+/// Ready threads change queues, so they are all taken out first, from the
+/// highest priority down, and put back in the same order.  The others are
+/// brought up when they next get ready or run.
+void
+Scheduler::Boost()
+{
+    if (numLevels == 0 || stats->totalTicks - lastBoost < MLFQ_BOOST_TICKS)
+        return;
+
+    DEBUG('t', "Boosting every thread to the top level.\n");
+    epoch++;
+    lastBoost = stats->totalTicks;
+
+    Thread *first = NULL, **last = &first;
+    for (int p = SCHEDULER_PRIORITY_NUMBER - 1; p >= 0; p--)
+        if (readyQueue[p].first != NULL) {
+            *last = readyQueue[p].first;
+            last  = &readyQueue[p].last->nextReady;
+            readyQueue[p].first = readyQueue[p].last = NULL;
+        }
+    for (unsigned w = 0; w < NUM_WORDS; w++)
+        nonEmpty[w] = 0;
+    nonEmptyWords = 0;
+
+    while (first != NULL) {
+        Thread *thread = first;
+        first = thread->nextReady;
+        Refresh(thread);
+        Enqueue(thread);
     }
-    return NULL;
 }
 
 /// Dispatch the CPU to `nextThread`.
@@ -88,8 +342,11 @@ Scheduler::Run(Thread *nextThread)
     }
 #endif
 
-    oldThread->CheckOverflow();  // Check if the old thread had an undetected
-                                 // stack overflow.
+    if (oldThread->status != READY)  // Else charged when made ready.
+        Charge(oldThread);
+    Dispatch(nextThread);
+    if (nextThread->pass > minPass)
+        minPass = nextThread->pass;
 
     currentThread = nextThread;  // Switch to the next thread.
     currentThread->setStatus(RUNNING);  // `nextThread` is now running.
@@ -110,8 +367,14 @@ Scheduler::Run(Thread *nextThread)
     // need to delete its carcass.  Note we cannot delete the thread before
     // now (for example, in `Thread::Finish`), because up to this point, we
     // were still running on the old thread's stack!
+    //
+    // A joinable thread is kept until joined, so that its `joinPort` is
+    // still there; the joiner deletes it.
     if (threadToBeDestroyed != NULL) {
-        delete threadToBeDestroyed;
+        if (threadToBeDestroyed->IsJoineable())
+            threadToBeDestroyed->FreeStack();
+        else
+            delete threadToBeDestroyed;
         threadToBeDestroyed = NULL;
     }
 
@@ -124,19 +387,28 @@ Scheduler::Run(Thread *nextThread)
 #endif
 }
 
-/// Print the scheduler state -- in other words, the contents of the ready
-/// list.
-///
-/// For debugging.
-static void
-ThreadPrint(Thread* t)
+void
+Scheduler::Dispatch(Thread *thread)
 {
-    t->Print();
+    thread->dispatched = BusyTicks();
+    if (thread->firstRun == -1)
+        thread->firstRun = stats->totalTicks;
 }
 
+/// Print the scheduler state -- in other words, the contents of the ready
+/// queues, from the highest priority down.
+///
+/// For debugging.
 void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Apply(ThreadPrint);
+    for (int p = SCHEDULER_PRIORITY_NUMBER - 1; p >= 0; p--) {
+        if (readyQueue[p].first == NULL)
+            continue;
+        printf("  priority %d: ", p);
+        for (Thread *t = readyQueue[p].first; t != NULL; t = t->nextReady)
+            t->Print();
+        printf("\n");
+    }
 }
@@ -10,18 +10,59 @@
 #ifndef NACHOS_THREADS_SCHEDULER__HH
 #define NACHOS_THREADS_SCHEDULER__HH
 
+/// Number of priorities, 0 being the lowest, that of background threads.
+/// At most 1024: see `Scheduler::nonEmpty`.
 #ifndef SCHEDULER_PRIORITY_NUMBER
-#define SCHEDULER_PRIORITY_NUMBER 10
+#define SCHEDULER_PRIORITY_NUMBER 64
+#endif
+
+#if SCHEDULER_PRIORITY_NUMBER > 1024
+#error "SCHEDULER_PRIORITY_NUMBER must not be over 1024"
 #endif
 
 
-#include "list.hh"
 #include "thread.hh"
 
 
+/// Most levels the multilevel feedback queue may have.
+const unsigned MLFQ_MAX_LEVELS = 8;
+
+/// Ticks between boosts of every thread to the top level of the multilevel
+/// feedback queue, so that threads demoted long ago get to run again.
+const unsigned MLFQ_BOOST_TICKS = 10000;
+
+/// Tickets of a thread under the stride scheduler, unless set otherwise,
+/// and the most it may have.
+const unsigned DEFAULT_TICKETS = 100;
+const unsigned MAX_TICKETS     = 10000;
+
+/// Stride of a thread with one ticket; that of one with `t` tickets is
+/// `STRIDE_ONE / t`.
+const unsigned STRIDE_ONE = 1 << 20;
+
+
 /// The following class defines the scheduler/dispatcher abstraction --
 /// the data structures and operations needed to keep track of which
 /// thread is running, and which threads are ready but not running.
+///
+/// Ready threads wait in a FIFO queue for each priority, linked through the
+/// threads themselves, and a bitmap tells which queues are not empty.  So
+/// putting a thread in and taking the next one out take the same time
+/// whatever the number of priorities and threads, and allocate nothing.
+///
+/// Priorities are fixed, unless the multilevel feedback queue is turned on.
+/// Then a thread starts at the top level, goes one level down each time it
+/// runs for the quantum of its level, and one level up each time it waits
+/// for the console or the disk; every `MLFQ_BOOST_TICKS` all threads go
+/// back to the top.  Level `i` of `n` adds `n - 1 - i` to the priority the
+/// thread was created with, so a CPU bound user program ends up below an
+/// interactive one, and both stay below the kernel threads given higher
+/// priorities.  Background threads stay at their priority, below them all.
+///
+/// The stride scheduler instead shares the processor among the threads of
+/// a priority in proportion to their tickets.  Each thread has a pass, that
+/// grows by its stride for each tick it runs, and the ready thread with the
+/// lowest pass runs next: queues are kept in order of pass.
 class Scheduler {
 public:
 
@@ -40,13 +81,110 @@ public:
     /// Cause `nextThread` to start running.
     void Run(Thread* nextThread);
 
+    /// `thread` starts running now: start charging it, and note its first
+    /// run.  `Run` does it for every thread it switches to; the main thread
+    /// is running from the start, without going through `Run`.
+    void Dispatch(Thread *thread);
+
+    /// Give `thread`, that must be ready, priority `priority`, moving it to
+    /// the back of the queue of its new priority.
+    void ChangePriority(Thread *thread, int priority);
+
+    /// Turn on the multilevel feedback queue.  `quanta` lists the quantum
+    /// of each level in ticks, separated by commas, from the top one.
+    /// Quanta are as coarse as the timer: they end at its next interrupt.
+    void UseMultilevel(const char *quanta);
+
+    bool IsMultilevel()
+    {
+        return numLevels > 0;
+    }
+
+    /// Turn on the stride scheduler.
+    void UseStride();
+
+    bool IsStride()
+    {
+        return stride;
+    }
+
+    /// Whether the timer should take the processor from the current
+    /// thread: always, unless the multilevel feedback queue is on and the
+    /// thread has quantum left, with no one of higher priority ready.
+    bool ShouldPreempt();
+
+    /// `thread`, the current one, is about to wait for a device.
+    void BlocksOnIO(Thread *thread);
+
+    /// The priority of `thread` when it is not lent one by a lock waiter.
+    int BasePriority(Thread *thread);
+
+    /// Print how long `thread`, about to finish, took to first run and to
+    /// finish, and how long it ran.  Response time and turnaround count
+    /// idle time too.
+    void PrintTimes(Thread *thread);
+
     // Print contents of ready list.
     void Print();
 
 private:
 
-    // Queue of threads that are ready to run, but not running.
-    List<Thread*> *readyList;
+    /// Bits of priority in each word of `nonEmpty`.
+    static const unsigned WORD_BITS = 32;
+
+    static const unsigned NUM_WORDS =
+      (SCHEDULER_PRIORITY_NUMBER + WORD_BITS - 1) / WORD_BITS;
+
+    /// Queue of threads of one priority that are ready to run, but not
+    /// running, linked through `Thread::nextReady` and `prevReady`.
+    struct Queue {
+        Thread *first;
+        Thread *last;
+    };
+
+    Queue readyQueue[SCHEDULER_PRIORITY_NUMBER];
+
+    /// Bit `p % WORD_BITS` of word `p / WORD_BITS` is set when the queue of
+    /// priority `p` is not empty, and bit `w` of `nonEmptyWords` when word
+    /// `w` is not zero.  The highest priority with ready threads is then
+    /// two bit scans away.
+    unsigned nonEmpty[NUM_WORDS];
+    unsigned nonEmptyWords;
+
+    /// Put `thread` at the back of the queue of its priority.
+    void Enqueue(Thread *thread);
+
+    /// Take `thread` out of the queue of its priority.
+    void Dequeue(Thread *thread);
+
+    /// Levels of the multilevel feedback queue, 0 if it is off, and the
+    /// quantum of each one.
+    unsigned numLevels;
+    unsigned quanta[MLFQ_MAX_LEVELS];
+
+    /// Number of boosts so far, and the tick of the last one.
+    unsigned epoch;
+    unsigned lastBoost;
+
+    /// Whether the stride scheduler is on, and the pass of the last thread
+    /// dispatched.  Threads that get ready start no lower than that, so
+    /// that having waited does not give them the processor for long.
+    bool stride;
+    unsigned long long minPass;
+
+    /// Charge `thread` with the ticks it ran since it was dispatched, and
+    /// demote it if it used up its quantum.  Return whether it did.
+    /// Advance its pass too.
+    bool Charge(Thread *thread);
+
+    /// Move `thread` to `level`, and so to its base priority there.
+    void SetLevel(Thread *thread, unsigned level);
+
+    /// Bring `thread` to the top level if it missed a boost.
+    void Refresh(Thread *thread);
+
+    /// Bring every thread to the top level, if it is time.
+    void Boost();
 
 };
 
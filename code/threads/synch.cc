@@ -34,16 +34,13 @@ Semaphore::Semaphore(const char *debugName, int initialValue)
 {
     name  = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
 }
 
 /// De-allocate semaphore, when no longer needed.
 ///
 /// Assume no one is still waiting on the semaphore!
 Semaphore::~Semaphore()
-{
-    delete queue;
-}
+{}
 
 /// Wait until semaphore `value > 0`, then decrement.
 ///
@@ -59,7 +56,7 @@ Semaphore::P()
       // Disable interrupts.
 
     while (value == 0) {  // Semaphore not available.
-        queue->Append(currentThread);  // So go to sleep.
+        queue.Append(currentThread);  // So go to sleep.
         currentThread->Sleep();
     }
     value--;  // Semaphore available, consume its value.
@@ -78,7 +75,7 @@ Semaphore::V()
     Thread   *thread;
     IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
 
-    thread = queue->Remove();
+    thread = queue.Remove();
     if (thread != NULL)  // Make thread ready, consuming the `V` immediately.
         scheduler->ReadyToRun(thread);
     value++;
@@ -125,7 +122,7 @@ void
 Lock::Release()
 {
     if(IsHeldByCurrentThread()) {
-        currentThread->setPriority(currentThread->getOriginalPriority());
+        currentThread->setPriority(scheduler->BasePriority(currentThread));
         holder = NULL;
         locksem->V();
     }
@@ -145,40 +142,113 @@ Condition::Condition(const char *debugName, Lock *conditionLock)
 {
     name = debugName;
     lock = conditionLock;
-    list = new List<Semaphore*>();
 }
 
 Condition::~Condition()
-{
-    delete list;
-}
+{}
 
+/// The thread queues itself before releasing the lock, with interrupts
+/// disabled until it sleeps, so that a `Signal` right after the release
+/// cannot be missed.
 void
 Condition::Wait()
 {
     ASSERT(lock->IsHeldByCurrentThread());
-    Semaphore *sem = new Semaphore("ConditionSem", 0);    
-    list->Append(sem);
 
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    waiters.Append(currentThread);
     lock->Release();
-    sem->P();
+    currentThread->Sleep();
+    interrupt->SetLevel(oldLevel);
+
     lock->Acquire();
 }
 
 void
 Condition::Signal()
 {
-    if(!(list->IsEmpty())){
-        (list->Remove())->V();
-    }
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Thread *thread = waiters.Remove();
+    if (thread != NULL)
+        scheduler->ReadyToRun(thread);
+    interrupt->SetLevel(oldLevel);
 }
 
 void
 Condition::Broadcast()
 {
-    while(!(list->IsEmpty())){
-        (list->Remove())->V();
-    }    
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Thread *thread;
+    while ((thread = waiters.Remove()) != NULL)
+        scheduler->ReadyToRun(thread);
+    interrupt->SetLevel(oldLevel);
+}
+
+/*******************************
+ * READERS/WRITER LOCK
+ *******************************/
+
+ReaderWriterLock::ReaderWriterLock(const char *debugName)
+{
+    name           = debugName;
+    lock           = new Lock(debugName);
+    canRead        = new Condition("RW lock can read", lock);
+    canWrite       = new Condition("RW lock can write", lock);
+    activeReaders  = 0;
+    waitingWriters = 0;
+    writing        = false;
+}
+
+ReaderWriterLock::~ReaderWriterLock()
+{
+    delete canRead;
+    delete canWrite;
+    delete lock;
+}
+
+void
+ReaderWriterLock::AcquireRead()
+{
+    lock->Acquire();
+    while (writing || waitingWriters > 0)
+        canRead->Wait();
+    activeReaders++;
+    lock->Release();
+}
+
+void
+ReaderWriterLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(activeReaders > 0);
+    if (--activeReaders == 0)
+        canWrite->Signal();
+    lock->Release();
+}
+
+void
+ReaderWriterLock::AcquireWrite()
+{
+    lock->Acquire();
+    waitingWriters++;
+    while (writing || activeReaders > 0)
+        canWrite->Wait();
+    waitingWriters--;
+    writing = true;
+    lock->Release();
+}
+
+void
+ReaderWriterLock::ReleaseWrite()
+{
+    lock->Acquire();
+    ASSERT(writing);
+    writing = false;
+    if (waitingWriters > 0)
+        canWrite->Signal();
+    else
+        canRead->Broadcast();
+    lock->Release();
 }
 
 /*******************************
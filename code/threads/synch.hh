@@ -20,7 +20,7 @@
 #define NACHOS_THREADS_SYNCH__HH
 
 
-#include "list.hh"
+#include "intrusive_list.hh"
 #include "thread.hh"
 
 
@@ -67,7 +67,7 @@ private:
     int value;
 
     /// Queue of threads waiting on `P` because the value is zero.
-    List<Thread *> *queue;
+    IntrusiveList<Thread, &Thread::nextWaiting> queue;
 
 };
 
@@ -182,11 +182,56 @@ private:
     // Useful lock
     Lock *lock;
 
-    // Semaphore for implementation
-    List<Semaphore *> *list;
+    /// Threads waiting to be signalled.
+    IntrusiveList<Thread, &Thread::nextWaiting> waiters;
 };
 
 
+/// This class defines a “readers/writer lock”.
+///
+/// Any number of readers may hold the lock at the same time, but a writer
+/// holds it alone.  Writers are preferred: once a writer is waiting, new
+/// readers wait too, so that a steady stream of readers cannot starve it.
+///
+/// * `AcquireRead`/`ReleaseRead` -- enter/leave as one of the readers.
+/// * `AcquireWrite`/`ReleaseWrite` -- enter/leave as the only writer.
+class ReaderWriterLock {
+public:
+
+    /// Constructor: set up the lock as free.
+    ReaderWriterLock(const char *debugName);
+
+    ~ReaderWriterLock();
+
+    /// For debugging.
+    const char *GetName()
+    {
+        return name;
+    }
+
+    void AcquireRead();
+    void ReleaseRead();
+    void AcquireWrite();
+    void ReleaseWrite();
+
+private:
+
+    /// For debugging.
+    const char *name;
+
+    /// Protects the counters below.
+    Lock *lock;
+
+    /// Readers wait here while there is a writer, active or waiting.
+    Condition *canRead;
+
+    /// Writers wait here while anyone else holds the lock.
+    Condition *canWrite;
+
+    unsigned activeReaders;
+    unsigned waitingWriters;
+    bool writing;
+};
 // This class defines a "port".
 //
 // A port is a message passing mechanism that allows senders to synch
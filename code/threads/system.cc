@@ -32,11 +32,12 @@ FileSystem *fileSystem;
 
 #ifdef FILESYS
 SynchDisk *synchDisk;
+FileTable *fileTable;  ///< Files that are open.
 #endif
 
 #ifdef USER_PROGRAM  // Requires either *FILESYS* or *FILESYS_STUB*.
 Machine *machine;  ///< User program memory and registers.
-BitMap *vpages;               ///< Keep track of translation from vpages to physpages.
+FrameAllocator *vpages;       ///< Keep track of the free physical frames.
 Thread **ptable;    ///< Keep track of process pid and address space.
 SynchConsole *sconsole;
 #endif
@@ -47,6 +48,7 @@ PostOffice *postOffice;
 
 #ifdef VMEM
 Coremap *coremap;
+SwapArea *swapArea;  ///< Pages evicted from memory.
 #endif
 
 // External definition, to allow us to take a pointer to this function.
@@ -69,7 +71,11 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(void *dummy)
 {
-    if (interrupt->getStatus() != IDLE_MODE)
+#ifdef VMEM
+    if (coremap != NULL)  // Not up yet while the file system starts.
+        coremap->Sample();
+#endif
+    if (interrupt->getStatus() != IDLE_MODE && scheduler->ShouldPreempt())
         interrupt->YieldOnReturn();
 }
 
@@ -96,12 +102,23 @@ Initialize(int argc, char **argv)
     bool preemptiveScheduling = false;
     long long timeSlice;
 
+    const char *quanta = NULL;  // Multilevel feedback queue.
+    bool stride = false;        // Stride scheduler.
+
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
+    unsigned numFrames = NUM_PHYS_PAGES;  // Size of physical memory.
 #endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // Format disk.
 #endif
+#ifdef FILESYS
+    unsigned numDisks = 1;  // Spindles to stripe the disk across.
+#endif
+#ifdef VMEM
+    const char *policy = DEFAULT_REPLACEMENT_POLICY;  // Page replacement.
+    unsigned swapCachePages = DEFAULT_SWAP_CACHE_PAGES;
+#endif
 #ifdef NETWORK
     double rely = 1;  // Network reliability.
     int netname = 0;  // UNIX socket name.
@@ -132,15 +149,44 @@ Initialize(int argc, char **argv)
                 timeSlice = atoi(*(argv+1));
                 argCount = 2;
             }
-        }
+        } else if (!strcmp(*argv, "-mlfq")) {
+            ASSERT(argc > 1);
+            quanta = *(argv + 1);
+            argCount = 2;
+        } else if (!strcmp(*argv, "-stride"))
+            stride = true;
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = true;
+        else if (!strcmp(*argv, "-pm")) {
+            ASSERT(argc > 1);
+            numFrames = atoi(*(argv + 1));
+            ASSERT(numFrames > 0);
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = true;
 #endif
+#ifdef FILESYS
+        if (!strcmp(*argv, "-nd")) {
+            ASSERT(argc > 1);
+            numDisks = atoi(*(argv + 1));
+            argCount = 2;
+        }
+#endif
+#ifdef VMEM
+        if (!strcmp(*argv, "-rp")) {
+            ASSERT(argc > 1);
+            policy = *(argv + 1);
+            argCount = 2;
+        } else if (!strcmp(*argv, "-sc")) {
+            ASSERT(argc > 1);
+            swapCachePages = atoi(*(argv + 1));
+            argCount = 2;
+        }
+#endif
 #ifdef NETWORK
         if (!strcmp(*argv, "-l")) {
             ASSERT(argc > 1);
@@ -158,6 +204,10 @@ Initialize(int argc, char **argv)
     stats = new Statistics();     // Collect statistics.
     interrupt = new Interrupt;    // Start up interrupt handling.
     scheduler = new Scheduler();  // Initialize the ready queue.
+    if (quanta != NULL)
+        scheduler->UseMultilevel(quanta);
+    else if (stride)
+        scheduler->UseStride();
 //  if (randomYield)              // Start the timer (if needed).
     timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -168,6 +218,7 @@ Initialize(int argc, char **argv)
     // object to save its state.
     currentThread = new Thread("main");
     currentThread->setStatus(RUNNING);
+    scheduler->Dispatch(currentThread);
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);  // If user hits ctl-C...
@@ -179,14 +230,21 @@ Initialize(int argc, char **argv)
     }
 
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg);  // This must come first.
-    vpages  = new BitMap(NUM_PHYS_PAGES);   // Create the translator.
+    // This must come first.  With virtual memory, there is one frame more:
+    // the zero frame of the coremap.
+#ifdef VMEM
+    machine = new Machine(debugUserProg, numFrames + 1);
+#else
+    machine = new Machine(debugUserProg, numFrames);
+#endif
+    vpages  = new FrameAllocator(numFrames);
     ptable  = new Thread * [MAX_NPROCS]();
     sconsole = new SynchConsole(NULL,NULL);   // Use default in, out
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", numDisks);
+    fileTable = new FileTable;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -198,7 +256,14 @@ Initialize(int argc, char **argv)
 #endif
 
 #ifdef VMEM
-    coremap = new Coremap(NUM_PHYS_PAGES);
+    coremap = new Coremap(numFrames, policy);
+    coremap->StartPageout();
+#ifdef FILESYS
+    swapArea = new SwapArea(fileSystem->SwapStart(),
+                            fileSystem->SwapSectors(), swapCachePages);
+#else
+    swapArea = new SwapArea("SWAP", NUM_SWAP_SLOTS, swapCachePages);
+#endif
 #endif
 }
 
@@ -220,18 +285,20 @@ Cleanup()
     delete vpages;
 #endif
 
+#ifdef VMEM
+    delete swapArea;  // Closes the swap file, so before the file system.
+    delete coremap;
+#endif
+
 #ifdef FILESYS_NEEDED
     delete fileSystem;
 #endif
 
 #ifdef FILESYS
+    delete fileTable;
     delete synchDisk;
 #endif
 
-#ifdef VMEM
-    delete coremap;
-#endif
-
     delete timer;
     delete scheduler;
     delete interrupt;
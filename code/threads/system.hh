@@ -17,6 +17,7 @@
 #include "machine/statistics.hh"
 #include "machine/timer.hh"
 #include "userprog/bitmap.hh"
+#include "userprog/frame_allocator.hh"
 #include "userprog/address_space.hh"
 #include "userprog/synch_console.hh"
 
@@ -36,7 +37,7 @@ extern Interrupt *interrupt;         ///< Interrupt status.
 extern Statistics *stats;            ///< Performance metrics.
 extern Timer *timer;                 ///< The hardware alarm clock.
 
-extern BitMap *vpages;               ///< Virtual page to physical page translator.
+extern FrameAllocator *vpages;       ///< Free physical frames.
 extern Thread **ptable;              ///< SpaceId table.
 extern SynchConsole *sconsole;
 
@@ -52,7 +53,9 @@ extern FileSystem *fileSystem;
 
 #ifdef FILESYS
 #include "filesys/synch_disk.hh"
+#include "filesys/file_table.hh"
 extern SynchDisk *synchDisk;
+extern FileTable *fileTable;
 #endif
 
 #ifdef NETWORK
@@ -62,7 +65,9 @@ extern PostOffice *postOffice;
 
 #ifdef VMEM
 #include "vmem/coremap.hh"
+#include "vmem/swap.hh"
 extern Coremap *coremap;
+extern SwapArea *swapArea;
 #endif
 
 #endif
@@ -23,9 +23,43 @@
 #include "system.hh"
 
 
-/// This is put at the top of the execution stack, for detecting stack
-/// overflows.
-const unsigned STACK_FENCEPOST = 0xdeadbeef;
+/// Stacks of threads that are gone are kept for the next threads, rather
+/// than given back to the host: a shell that runs program after program
+/// would otherwise map and unmap a stack for each.  The pool holds at most
+/// `STACK_POOL_SIZE` stacks, linked through their top word.
+static const unsigned STACK_POOL_SIZE = 16;
+
+/// Top of the stacks in the pool that stays committed; the host reclaims
+/// the rest, deep as the thread that last used it might have gone.
+static const unsigned STACK_KEEP = 16 * 1024;
+
+static HostMemoryAddress *stackPool;
+static unsigned stackPoolSize;
+
+static HostMemoryAddress *
+TakeStack()
+{
+    HostMemoryAddress *stack = stackPool;
+
+    if (stack == NULL)
+        return (HostMemoryAddress *) AllocStack(STACK_SIZE * sizeof *stack);
+    stackPool = (HostMemoryAddress *) stack[STACK_SIZE - 1];
+    stackPoolSize--;
+    return stack;
+}
+
+static void
+GiveStack(HostMemoryAddress *stack)
+{
+    if (stackPoolSize == STACK_POOL_SIZE) {
+        DeallocStack((char *) stack, STACK_SIZE * sizeof *stack);
+        return;
+    }
+    ReleaseStack((char *) stack, STACK_SIZE * sizeof *stack, STACK_KEEP);
+    stack[STACK_SIZE - 1] = (HostMemoryAddress) stackPool;
+    stackPool = stack;
+    stackPoolSize++;
+}
 
 /// Initialize a thread control block, so that we can then call
 /// `Thread::Fork`.
@@ -39,6 +73,18 @@ Thread::Thread(const char* threadName, int prior, bool joineable)
     status           = JUST_CREATED;
     priority         = prior;
     originalPriority = prior;
+    nextReady        = NULL;
+    prevReady        = NULL;
+    nextWaiting      = NULL;
+    level            = 0;
+    boostEpoch       = 0;
+    sliceUsed        = 0;
+    dispatched       = stats->userTicks + stats->systemTicks;
+    ticksRun         = 0;
+    tickets          = DEFAULT_TICKETS;
+    pass             = 0;
+    arrival          = stats->totalTicks;
+    firstRun         = -1;
     isJoineable      = joineable;
     if (isJoineable)
         joinPort     = new Port(threadName);
@@ -61,9 +107,18 @@ Thread::~Thread()
 {
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
+    ASSERT(this != currentThread);
+    FreeStack();
+    delete joinPort;
+}
+
+void
+Thread::FreeStack()
+{
     ASSERT(this != currentThread);
     if (stack != NULL)
-        DeallocBoundedArray((char *) stack, STACK_SIZE * sizeof *stack);
+        GiveStack(stack);
+    stack = NULL;
 }
 
 /// Invoke `(*func)(arg)`, allowing caller and callee to execute
@@ -101,26 +156,6 @@ Thread::Fork(VoidFunctionPtr func, void* arg)
     interrupt->SetLevel(oldLevel);
 }
 
-/// Check a thread's stack to see if it has overrun the space that has been
-/// allocated for it.  If we had a smarter compiler, we would not need to
-/// worry about this, but we do not.
-///
-/// NOTE: Nachos will not catch all stack overflow conditions.  In other
-/// words, your program may still crash because of an overflow.
-///
-/// If you get bizarre results (such as seg faults where there is no code)
-/// then you *may* need to increase the stack size.  You can avoid stack
-/// overflows by not putting large data structures on the stack.  Do not do
-/// this:
-///         void foo() { int bigArray[10000]; ... }
-void
-Thread::CheckOverflow()
-{
-    if (stack != NULL) {
-        ASSERT(*stack == STACK_FENCEPOST);
-    }
-}
-
 /// Called by `ThreadRoot` when a thread is done executing the forked
 /// procedure. The return status is passed on to the joining parent
 /// if any.
@@ -140,6 +175,8 @@ Thread::Finish(int status)
     ASSERT(this == currentThread);
 
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
+    if (scheduler->IsMultilevel() || scheduler->IsStride())
+        scheduler->PrintTimes(this);
 
     if (isJoineable)
         joinPort->Send(status); //Waits for father to end
@@ -174,10 +211,20 @@ Thread::Yield()
 
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
 
-    nextThread = scheduler->FindNextToRun();
-    if (nextThread != NULL) {
+    if (scheduler->IsStride()) {
+        // The thread competes too: it may still have the lowest pass.
         scheduler->ReadyToRun(this);
-        scheduler->Run(nextThread);
+        nextThread = scheduler->FindNextToRun();
+        if (nextThread != this)
+            scheduler->Run(nextThread);
+        else
+            status = RUNNING;
+    } else {
+        nextThread = scheduler->FindNextToRun();
+        if (nextThread != NULL) {
+            scheduler->ReadyToRun(this);
+            scheduler->Run(nextThread);
+        }
     }
     interrupt->SetLevel(oldLevel);
 }
@@ -214,6 +261,20 @@ Thread::Sleep()
     scheduler->Run(nextThread);  // Returns when we have been signalled.
 }
 
+/// A ready thread is in the queue of its priority, so it has to move: this
+/// happens when a lock holder that is waiting to run inherits a priority.
+void
+Thread::setPriority(int p)
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    if (status == READY)
+        scheduler->ChangePriority(this, p);
+    else
+        priority = p;
+    interrupt->SetLevel(oldLevel);
+}
+
 /// ThreadFinish, InterruptEnable
 ///
 /// Dummy functions because C++ does not allow a pointer to a member
@@ -244,8 +305,7 @@ InterruptEnable()
 void
 Thread::StackAllocate(VoidFunctionPtr func, void *arg)
 {
-    stack = (HostMemoryAddress *) AllocBoundedArray(STACK_SIZE
-                                                    * sizeof *stack);
+    stack = TakeStack();
 
     // i386 & MIPS & SPARC stack works from high addresses to low addresses.
     stackTop = stack + STACK_SIZE - 4;  // -4 to be on the safe side!
@@ -256,8 +316,6 @@ Thread::StackAllocate(VoidFunctionPtr func, void *arg)
     // `ThreadRoot`.
     *--stackTop = (HostMemoryAddress) ThreadRoot;
 
-    *stack = STACK_FENCEPOST;
-
     machineState[PCState]         = (HostMemoryAddress) ThreadRoot;
     machineState[StartupPCState]  = (HostMemoryAddress) InterruptEnable;
     machineState[InitialPCState]  = (HostMemoryAddress) func;
@@ -277,6 +335,7 @@ Thread::Join()
     joinPort->Receive(&retAddr); //Wait for child to return.
 
     delete joinPort;
+    joinPort = NULL;
 }
 
 ///
@@ -15,11 +15,10 @@
 ///
 ///     void foo() { int *buf = new int[1000]; ...}
 ///
-/// Bad things happen if you overflow the stack, and in the worst case, the
-/// problem may not be caught explicitly.  Instead, the only symptom may be
-/// bizarre segmentation faults.  (Of course, other problems can cause seg
-/// faults, so that is not a sure sign that your thread stacks are too
-/// small.)
+/// Overflowing the stack runs into an inaccessible guard page below it, so
+/// the symptom is a segmentation fault in the function that overran.  (Of
+/// course, other problems can cause seg faults, so that is not a sure sign
+/// that your thread stacks are too small.)
 ///
 /// One thing to try if you find yourself with segmentation faults is to
 /// increase the size of thread stack -- `STACK_SIZE`.
@@ -66,6 +65,12 @@ const unsigned MACHINE_STATE_SIZE = 17;
 /// WATCH OUT IF THIS IS NOT BIG ENOUGH!!!!!
 const unsigned STACK_SIZE = 400 * 1024;
 
+/// Priority of background threads, the lowest one: they only run when no
+/// other thread is ready.  Every other thread gets `DEFAULT_PRIORITY`,
+/// unless given a higher one.
+const int BACKGROUND_PRIORITY = 0;
+const int DEFAULT_PRIORITY    = 1;
+
 
 /// Thread state.
 enum ThreadStatus {
@@ -100,7 +105,8 @@ private:
 public:
 
     /// Initialize a `Thread`.
-    Thread(const char *debugName, int prior = 0, bool joineable = false);
+    Thread(const char *debugName, int prior = DEFAULT_PRIORITY,
+           bool joineable = false);
 
     /// Deallocate a Thread.
     ///
@@ -123,10 +129,18 @@ public:
     void Finish(int status = 0);
 
     /// The thread waits for a children.
+    ///
+    /// A joinable thread is not deleted when it finishes, only its stack
+    /// is; the thread that joins it must delete it afterwards.
     void Join();
 
-    /// Check if thread has overflowed its stack.
-    void CheckOverflow();
+    bool IsJoineable()
+    {
+        return isJoineable;
+    }
+
+    /// De-allocate the stack of a thread that finished.
+    void FreeStack();
 
     void setStatus(ThreadStatus st)
     {
@@ -148,16 +162,28 @@ public:
         return priority;
     }
 
-    void setPriority(int p)
-    {
-        priority = p;
-    }
+    /// Change the priority; a ready thread moves to its new queue.
+    void setPriority(int p);
+
+    /// Next thread waiting on the same semaphore or condition as this one.
+    Thread *nextWaiting;
 
     int getOriginalPriority()
     {
         return originalPriority;
     }
 
+    /// Share of the processor under the stride scheduler.
+    unsigned getTickets()
+    {
+        return tickets;
+    }
+
+    void setTickets(unsigned t)
+    {
+        tickets = t;
+    }
+
     OpenFileId AddFile(OpenFile *file);
 
     bool RemoveFile(OpenFileId fid);
@@ -193,6 +219,25 @@ private:
 
     int originalPriority;
 
+    /// Neighbours in the queue of the scheduler for `priority`, while
+    /// ready.
+    Thread *nextReady;
+    Thread *prevReady;
+
+    /// Accounting for the multilevel feedback queue and the stride
+    /// scheduler, in ticks.  Ticks run count user and system time only.
+    unsigned level;       ///< Level, 0 being the top one.
+    unsigned boostEpoch;  ///< Last boost it got.
+    unsigned sliceUsed;   ///< Ticks run at this level.
+    unsigned dispatched;  ///< Ticks run by anyone when it last started.
+    unsigned ticksRun;    ///< Ticks run in all.
+    unsigned tickets;
+    unsigned long long pass;  ///< Virtual time: ticks run over tickets.
+    unsigned arrival;     ///< When it was created.
+    int firstRun;         ///< When it first ran, or -1 if it has not yet.
+
+    friend class Scheduler;
+
     OpenFile *fileTable[MAX_OPEN_FILES] = {};
 
 #ifdef USER_PROGRAM
@@ -49,9 +49,93 @@ ThreadTest()
 
     char *name  = new char[64];
     strncpy(name, "2nd", 64);
-    Thread *newThread  = new Thread(name, 1, true); //Is joineable
+    Thread *newThread  = new Thread(name, DEFAULT_PRIORITY + 1, true); //Is joineable
     newThread->Fork(SimpleThread, (void *) name);
     //newThread->Join();
 
     SimpleThread((void *) "1st");
 }
+
+/// Threads of the scheduling benchmark, and their tickets.
+static const unsigned BENCH_THREADS = 3;
+static const unsigned BENCH_TICKETS[BENCH_THREADS] = { 100, 200, 400 };
+
+/// Ticks the benchmark lasts, and those at the first report; each report
+/// comes twice as late as the one before.
+static const unsigned BENCH_TICKS        = 128000;
+static const unsigned BENCH_FIRST_REPORT = 1000;
+
+static unsigned benchStart;
+static unsigned benchNextReport;
+static unsigned benchTurns[BENCH_THREADS];
+static Semaphore *benchDone;
+
+static void
+BenchReport(unsigned elapsed)
+{
+    unsigned total = 0;
+
+    for (unsigned i = 0; i < BENCH_THREADS; i++)
+        total += benchTurns[i];
+    printf("%8u ticks:", elapsed);
+    for (unsigned i = 0; i < BENCH_THREADS; i++)
+        printf("  %5.1f%%", total > 0 ? 100.0 * benchTurns[i] / total : 0.0);
+    printf("\n");
+}
+
+/// Spin until the benchmark is over.  Every turn of the loop takes the same
+/// ticks, so the turns each thread made tell the share of the processor it
+/// got.  Whoever gets to a report time first prints the report.
+static void
+BenchSpinner(void *index_)
+{
+    unsigned index = (unsigned) (long) index_;
+
+    for (;;) {
+        // Let a tick go by: the timer may preempt here.
+        interrupt->SetLevel(INT_OFF);
+        interrupt->SetLevel(INT_ON);
+
+        unsigned elapsed = stats->totalTicks - benchStart;
+        if (elapsed >= BENCH_TICKS)
+            break;
+        benchTurns[index]++;
+        if (elapsed >= benchNextReport) {
+            BenchReport(elapsed);
+            benchNextReport *= 2;
+        }
+    }
+    benchDone->V();
+}
+
+/// Run threads with different tickets side by side, and print the share of
+/// the processor each got so far from time to time.  Under the stride
+/// scheduler (`-stride`) the shares approach those of the tickets; else
+/// the threads take turns.
+void
+SchedulerBenchmark()
+{
+    unsigned totalTickets = 0;
+
+    benchDone       = new Semaphore("bench done", 0);
+    benchStart      = stats->totalTicks;
+    benchNextReport = BENCH_FIRST_REPORT;
+    for (unsigned i = 0; i < BENCH_THREADS; i++)
+        totalTickets += BENCH_TICKETS[i];
+    printf("Tickets:       ");
+    for (unsigned i = 0; i < BENCH_THREADS; i++) {
+        printf("  %5.1f%%", 100.0 * BENCH_TICKETS[i] / totalTickets);
+        benchTurns[i] = 0;
+    }
+    printf("\n");
+
+    for (unsigned i = 0; i < BENCH_THREADS; i++) {
+        Thread *t = new Thread("bench spinner");
+        t->setTickets(BENCH_TICKETS[i]);
+        t->Fork(BenchSpinner, (void *) (long) i);
+    }
+    for (unsigned i = 0; i < BENCH_THREADS; i++)
+        benchDone->P();
+    BenchReport(stats->totalTicks - benchStart);
+    delete benchDone;
+}
@@ -39,85 +39,352 @@ SwapHeader(NoffHeader *noffH)
     noffH->uninitData.inFileAddr  = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+/// Whether some of `segment` lies in virtual page `vpn`.
+static bool
+Overlaps(const Segment *segment, unsigned vpn)
+{
+    unsigned pageStart    = vpn * PAGE_SIZE;
+    unsigned segmentStart = segment->virtualAddr;
+
+    return segment->size > 0
+           && pageStart < segmentStart + segment->size
+           && segmentStart < pageStart + PAGE_SIZE;
+}
+
+/// Number of pages needed to hold `size` bytes.
+static inline unsigned
+PagesFor(unsigned size)
+{
+    return divRoundUp(size, PAGE_SIZE);
+}
+
+void
+AddressSpace::LoadFromSegment(const Segment *segment, unsigned vpn,
+                              unsigned ppn)
+{
+    if (!Overlaps(segment, vpn))
+        return;  // Nothing of this segment in this page.
+
+    unsigned pageStart    = vpn * PAGE_SIZE;
+    unsigned pageEnd      = pageStart + PAGE_SIZE;
+    unsigned segmentStart = segment->virtualAddr;
+    unsigned segmentEnd   = segmentStart + segment->size;
+    unsigned start = segmentStart > pageStart ? segmentStart : pageStart;
+    unsigned end   = segmentEnd < pageEnd ? segmentEnd : pageEnd;
+    int      res   = executable->ReadAt(
+        &machine->mainMemory[ppn * PAGE_SIZE + start - pageStart],
+        end - start, segment->inFileAddr + start - segmentStart);
+    ASSERT(res == (int) (end - start));
+}
+
+/// A page may hold the end of the code and the beginning of the data, so
+/// both segments are looked at.
+void
+AddressSpace::LoadPage(unsigned vpn, unsigned ppn)
+{
+    bzero(&machine->mainMemory[ppn * PAGE_SIZE], PAGE_SIZE);
+    LoadFromSegment(&noffH.code, vpn, ppn);
+    LoadFromSegment(&noffH.initData, vpn, ppn);
+}
+
 #ifdef USE_DML
 //Load a single page from the noffH where the address addr is
-void
-AddressSpace::LoadSegment(int vaddr)
+//
+//With virtual memory, pages of pure code are taken from the coremap,
+//shared with every other process running the same executable.  They are
+//mapped read-only; a write to one of them gets a private copy.  Pages
+//that start out full of zeros map the zero frame, read-only too, and get
+//a frame of their own on the first write.
+bool
+AddressSpace::LoadSegment(int vaddr, bool wait, bool *read)
 {
     DEBUG('z',"Loading segment from addr: %u\n",vaddr);
-    Segment segment;
-    bool zeroOut = false;
-    if((vaddr >= noffH.code.virtualAddr) && (vaddr <= noffH.code.virtualAddr + noffH.code.size)){ //Code segment
-        segment = noffH.code;
-        DEBUG('z',"Address: [%u] was found to be in code\n", vaddr);
-    } else if((vaddr >= noffH.initData.virtualAddr) && (vaddr <= noffH.initData.virtualAddr + noffH.initData.size)){ //InitData segment
-        segment = noffH.initData;
-        DEBUG('z',"Address: [%u] was found to be in initData\n", vaddr);
-    } else { //UninitData or stack segment
-        segment = noffH.uninitData;
-        zeroOut = true;
-        DEBUG('z',"Address: [%u] was found to be in uninitData\n", vaddr);
-    }
-    
+
     int vpn = vaddr / PAGE_SIZE;
+    TranslationEntry *entry = pageTable->Entry(vpn);
+    bool text = false, loaded = false;
 #ifndef VMEM
     int ppn = vpages->Find();
 #else
-    int ppn = coremap->Find(currentThread->space, vpn);
+    if (IsZeroFill(vpn)) {
+        DEBUG('8', "ZERO PAGE: %d\n", vpn);
+        if (read != NULL)
+            *read = false;
+        entry->physicalPage = coremap->ZeroFrame();
+        entry->valid        = true;
+        entry->dirty        = false;
+        entry->readOnly     = true;
+        return true;
+    }
+
+    int ppn;
+    text = IsText(vpn);
+    if (text)
+        ppn = coremap->FindText(this, vpn, executable->HeaderSector(),
+                                &loaded, wait);
+    else
+        ppn = coremap->Find(this, vpn, wait);
 #endif
+    if (ppn == -1 && !wait)
+        return false;  // No frame to spare.
     ASSERT(ppn >= 0);
-    pageTable[vpn].physicalPage = ppn;
-    int pp = ppn * PAGE_SIZE;
+    entry->physicalPage = ppn;
+    if (!loaded)
+        LoadPage(vpn, ppn);
+    if (read != NULL)
+        *read = !loaded;
+
+    entry->valid = true; //Now that the page is loaded, set it as valid
+    entry->dirty = false;
+    entry->readOnly = text;
+#ifdef VMEM
+    coremap->Unpin(ppn);
+#endif
+    return true;
+}
 
-    for (int j = 0; (j < (int)PAGE_SIZE) && (j < executable->Length() - vpn * (int)PAGE_SIZE - segment.inFileAddr); j++){
-        char c;
+/// A page holding the end of the code and the beginning of the data is
+/// not text: it may be written.
+bool
+AddressSpace::IsText(unsigned vpn)
+{
+    unsigned pageStart = vpn * PAGE_SIZE;
+    unsigned codeStart = noffH.code.virtualAddr;
 
-        if(!zeroOut){ // Load the data
-            int res = executable->ReadAt(&c, 1, j + segment.inFileAddr + vpn*PAGE_SIZE - segment.virtualAddr);
-            ASSERT(res == 1);
-        } else { // Zero-Out the uninitData
-            c = (char)0;
-        }
+    return noffH.code.size > 0
+           && codeStart <= pageStart
+           && pageStart + PAGE_SIZE <= codeStart + noffH.code.size;
+}
 
-        int paddr  = pp + j;
-        machine->mainMemory[paddr] = c;
+bool
+AddressSpace::IsZeroFill(unsigned vpn)
+{
+    return !Overlaps(&noffH.code, vpn) && !Overlaps(&noffH.initData, vpn);
+}
+#endif
+
+#if defined(VMEM) && defined(USE_DML)
+/// A scan faults on consecutive pages, except those read ahead of it; so a
+/// fault is sequential if it lands right after the last page brought in.
+/// Each sequential fault reads twice as many pages ahead as the previous
+/// one, up to `MAX_READ_AHEAD`.
+void
+AddressSpace::ReadAhead(unsigned vpn)
+{
+    if (vpn == nextFault)
+        readAhead = readAhead == 0 ? 1 : 2 * readAhead;
+    else
+        readAhead = 0;
+    if (readAhead > MAX_READ_AHEAD)
+        readAhead = MAX_READ_AHEAD;
+
+    unsigned next = vpn + 1;
+    while (next <= vpn + readAhead && IsValid(next) && Prefetch(next))
+        next++;
+    nextFault = next;
+}
+
+bool
+AddressSpace::Prefetch(unsigned vpn)
+{
+    TranslationEntry *entry = pageTable->Entry(vpn);
+    int ppn = entry->physicalPage;
+
+    if (ppn >= 0)
+        return true;  // Already in memory.
+    if (ppn == -1) {
+        if (!LoadSegment(vpn * PAGE_SIZE, false))
+            return false;
+    } else {
+        ppn = coremap->Find(this, vpn, false);
+        if (ppn == -1)
+            return false;
+        LoadFromSwap(vpn, ppn);
+    }
+    DEBUG('8', "PREFETCH PAGE: %u\n", vpn);
+    entry->use = false;  // Until it is really used.
+    return true;
+}
+
+/// Text pages loaded by other processes running the same program are
+/// mapped first.  That may switch threads, which empties the TLB; so the
+/// TLB is filled afterwards, in one go.  Only free TLB entries are taken:
+/// the entries in use are more likely to be needed than the neighbours.
+void
+AddressSpace::FaultAround(unsigned vpn)
+{
+#ifdef USE_TLB
+    unsigned first = vpn - vpn % FAULT_AROUND_PAGES;
+    unsigned last  = first + FAULT_AROUND_PAGES < numPages
+                     ? first + FAULT_AROUND_PAGES : numPages;
+
+    for (unsigned i = first; i < last; i++) {
+        TranslationEntry *entry = pageTable->Lookup(i);
+        if (entry == NULL || (int) entry->physicalPage != -1 || !IsText(i))
+            continue;
+        int ppn = coremap->MapText(this, i, executable->HeaderSector());
+        if (ppn != -1) {
+            entry->physicalPage = ppn;
+            entry->valid        = true;
+            entry->dirty        = false;
+            entry->use          = false;
+            entry->readOnly     = true;
+            coremap->Unpin(ppn);
+        }
     }
 
-    pageTable[vpn].valid = true; //Now that the page is loaded, set it as valid
+    unsigned free = 0;
+    for (unsigned i = first; i < last; i++) {
+        TranslationEntry *entry = pageTable->Lookup(i);
+        if (i == vpn || entry == NULL || !entry->valid || TlbEntry(i) != NULL)
+            continue;
+        while (free < TLB_SIZE && machine->tlb[free].valid)
+            free++;
+        if (free == TLB_SIZE)
+            return;
+        machine->tlb[free] = *entry;
+    }
+#endif
 }
 #endif
 
 #ifdef VMEM
-// Write a page to SWAP
+bool
+AddressSpace::Unmap(unsigned vpn)
+{
+    TranslationEntry *entry = pageTable->Entry(vpn);
+
+    DropTlbEntry(vpn);
+    entry->valid = false;
+    return entry->dirty;
+}
+
 void
-AddressSpace::SaveToSwap(int vpn)
+AddressSpace::PagedOut(unsigned vpn, int slot)
+{
+    TranslationEntry *entry = pageTable->Entry(vpn);
+    int *old = pageTable->SwapSlot(vpn);
+
+    if (*old == -1 && slot != -1)
+        numSwapSlots++;
+    else if (*old != -1 && slot == -1)
+        numSwapSlots--;
+    *old = slot;
+    entry->valid        = false;
+    entry->dirty        = false;
+    entry->readOnly     = false;
+    entry->physicalPage = slot != -1 ? -2 : -1;
+}
+
+int
+AddressSpace::SwapSlot(unsigned vpn)
+{
+    return *pageTable->SwapSlot(vpn);
+}
+
+/// While a page is in the TLB, the hardware sets its bits there and not in
+/// the page table.  Only the running address space has entries in the TLB.
+TranslationEntry *
+AddressSpace::TlbEntry(unsigned vpn)
 {
-    DEBUG('8', "SAVE PAGE: %d\n", vpn);
-    int ppn = pageTable[vpn].physicalPage;
-    swapfile->WriteAt(&machine->mainMemory[ppn * PAGE_SIZE], PAGE_SIZE, vpn * PAGE_SIZE);
-    /*Invalidar la entrada TLB si es el mismo proceso*/
 #ifdef USE_TLB
-    if(this == currentThread->space){
-        for (int i = 0; i < TLB_SIZE; i++){
-            if (machine->tlb[i].valid && machine->tlb[i].virtualPage == vpn) {
-                pageTable[machine->tlb[i].virtualPage] = machine->tlb[i];
-                machine->tlb[i].valid = false;
-            }
-        }
-    }
+    if (this == currentThread->space)
+        for (unsigned i = 0; i < TLB_SIZE; i++)
+            if (machine->tlb[i].valid && machine->tlb[i].virtualPage == vpn)
+                return &machine->tlb[i];
 #endif
-    pageTable[vpn].valid = false;
-    pageTable[vpn].physicalPage = -2;
+    return NULL;
+}
+
+void
+AddressSpace::DropTlbEntry(unsigned vpn)
+{
+    TranslationEntry *entry = TlbEntry(vpn);
+
+    if (entry != NULL) {
+        *pageTable->Entry(vpn) = *entry;
+        entry->valid = false;
+    }
+}
+
+bool
+AddressSpace::IsReferenced(unsigned vpn)
+{
+    TranslationEntry *entry = TlbEntry(vpn);
+
+    return pageTable->Entry(vpn)->use || (entry != NULL && entry->use);
 }
 
-// Load a page from SWAP
+bool
+AddressSpace::TestAndClearUse(unsigned vpn)
+{
+    TranslationEntry *entry = TlbEntry(vpn);
+    bool used = pageTable->Entry(vpn)->use;
+
+    pageTable->Entry(vpn)->use = false;
+    if (entry != NULL) {
+        used = used || entry->use;
+        entry->use = false;
+    }
+    return used;
+}
+
+bool
+AddressSpace::IsDirty(unsigned vpn)
+{
+    TranslationEntry *entry = TlbEntry(vpn);
+
+    return pageTable->Entry(vpn)->dirty || (entry != NULL && entry->dirty);
+}
+
+int
+AddressSpace::Frame(unsigned vpn)
+{
+    TranslationEntry *entry = vpn < numPages ? pageTable->Lookup(vpn) : NULL;
+
+    return entry != NULL && (int) entry->physicalPage >= 0
+           ? (int) entry->physicalPage : -1;
+}
+
+/// Pages that went out together are in consecutive slots, and are read in
+/// a single request.  The others are only loaded ahead of use, so their use
+/// bits stay clear.
 void
 AddressSpace::LoadFromSwap(int vpn, int ppn)
 {
+    char pages[SWAP_CLUSTER * PAGE_SIZE];
+    unsigned frames[SWAP_CLUSTER];
+    unsigned count = 1;
+    int slot = *pageTable->SwapSlot(vpn);
+
     DEBUG('8', "LOAD PAGE: %d\n", vpn);
-    swapfile->ReadAt(&machine->mainMemory[ppn * PAGE_SIZE], PAGE_SIZE, vpn * PAGE_SIZE);
-    pageTable[vpn].physicalPage = ppn;
-    pageTable[vpn].valid = true;
+    ASSERT(slot != -1);
+    frames[0] = ppn;
+    while (count < SWAP_CLUSTER && vpn + count < numPages) {
+        TranslationEntry *next = pageTable->Lookup(vpn + count);
+        if (next == NULL || (int) next->physicalPage != -2
+              || *pageTable->SwapSlot(vpn + count) != slot + (int) count)
+            break;
+        int frame = coremap->Find(this, vpn + count, false);
+        if (frame == -1)
+            break;
+        frames[count++] = frame;
+    }
+
+    swapArea->ReadPages(slot, count, pages);
+    stats->paging.swapIns += count;
+    paging.swapIns        += count;
+    for (unsigned i = 0; i < count; i++) {
+        TranslationEntry *entry = pageTable->Entry(vpn + i);
+        memcpy(&machine->mainMemory[frames[i] * PAGE_SIZE],
+               &pages[i * PAGE_SIZE], PAGE_SIZE);
+        entry->physicalPage = frames[i];
+        entry->valid = true;
+        entry->dirty = false;  // Same as the copy in swap.
+        if (i > 0)
+            entry->use = false;
+        coremap->Unpin(frames[i]);
+    }
 }
 #endif
 
@@ -129,8 +396,10 @@ AddressSpace::LoadFromSwap(int vpn, int ppn)
 /// Assumes that the object code file is in NOFF format.
 ///
 /// First, set up the translation from program memory to physical memory.
-/// For now, this is really simple (1:1), since we are only uniprogramming,
-/// and we have a single unsegmented page table.
+/// With a TLB, the address space spans `USER_ADDRESS_SPACE_PAGES`, with the
+/// stack at the top; page table entries are only made as pages are used.
+/// Otherwise the stack comes right after the data, and every page is
+/// loaded right away.
 ///
 /// * `executable` is the file containing the object code to load into
 ///   memory.
@@ -146,111 +415,303 @@ AddressSpace::AddressSpace(OpenFile *exec)
     ASSERT(noffH.noffMagic == NOFFMAGIC);
 
     // How big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size
-           + USER_STACK_SIZE;
+    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size;
+#ifdef USE_TLB
+    brk         = size;
+    numPages    = USER_ADDRESS_SPACE_PAGES;
+    stackBottom = numPages - PagesFor(USER_STACK_SIZE);
+    ASSERT(PagesFor(brk) < stackBottom);
+#else
     // We need to increase the size to leave room for the stack.
-    numPages = divRoundUp(size, PAGE_SIZE);
+    numPages = divRoundUp(size + USER_STACK_SIZE, PAGE_SIZE);
+#endif
     size = numPages * PAGE_SIZE;
 
-    // Check we are not trying to run anything too big -- at least until we
-    // have virtual memory.
     DEBUG('a', "Initializing address space, num pages %u, size %u\n",
           numPages, size);
 
+#if defined(VMEM) && defined(USE_DML)
+    nextFault = 0;
+    readAhead = 0;
+#endif
 #ifdef VMEM
-    //Create the SWAP file
-    int j;
-    for(j = 0; j < MAX_NPROCS; j++){
-        if(currentThread == ptable[j])
-            break;
-    }
-    ASSERT(ptable[j] == currentThread);
-    char sname[128];//5 + (int)(log10(j) + 1) + 1];
-    sprintf(sname, "SWAP.%d", j);
-    ASSERT(fileSystem->Create(sname, size)); //TODO: DELETE
-    swapfile = fileSystem->Open(sname);
+    mappings     = NULL;
+    numSwapSlots = 0;
 #endif
 
     // First, set up the translation.
 
-    pageTable = new TranslationEntry[numPages]; 
-    for (unsigned i = 0; i < numPages; i++) {
-        pageTable[i].virtualPage  = i;
-#ifdef USE_DML
-        pageTable[i].physicalPage = -1;
-        pageTable[i].valid        = false;
-#else
-        pageTable[i].physicalPage = vpages->Find(); 
-        ASSERT(pageTable[i].physicalPage >=0); 
-        DEBUG('j',"Assigning physPage: [%d]%d \n",i ,pageTable[i].physicalPage);
-        pageTable[i].valid        = true;
-#endif
-        pageTable[i].use          = false;
-#ifdef VMEM 
-        pageTable[i].dirty        = true;                  //esto avisa que la pag nunca fue a swap
+#ifdef USE_TLB
+    pageTable = new PageTable(numPages, PAGE_TABLE_LEAF_PAGES);
 #else
-        pageTable[i].dirty        = false;
+    pageTable = new PageTable(numPages, numPages);
 #endif
-        pageTable[i].readOnly     = false;
+#ifndef USE_DML
+    for (unsigned i = 0; i < numPages; i++) {
+        TranslationEntry *entry = pageTable->Entry(i);
+        entry->physicalPage = vpages->Find();
+        ASSERT((int) entry->physicalPage >= 0);  // Out of memory.
+        DEBUG('j',"Assigning physPage: [%d]%d \n",i ,entry->physicalPage);
+        entry->valid        = true;
         // If the code segment was entirely on a separate page, we could
         // set its pages to be read-only.
     }
+#endif
 
     DEBUG('a', "Finished initialization...\n");
 
 #ifndef USE_DML
-    // Zero out the entire address space, to zero the unitialized data
-    // segment and the stack segment.
+    // Copy in the code and data segments, a page at a time, zeroing out
+    // the rest (the unitialized data segment and the stack segment).
     for (unsigned i = 0; i < numPages; i++) {
-        if((int)pageTable[i].physicalPage>= 0) {
-            DEBUG('j', "Zeroing out [%d]%d \n", i, pageTable[i].physicalPage);
-            bzero(&(machine->mainMemory[pageTable[i].physicalPage * PAGE_SIZE]), PAGE_SIZE);
-        }
+        DEBUG('j', "Loading [%d]%d \n", i, pageTable->Entry(i)->physicalPage);
+        LoadPage(i, pageTable->Entry(i)->physicalPage);
     }
+#endif
+}
 
-    DEBUG('a', "Finished zeroing out the pagetable address... \n");
-
-    // Then, copy in the code and data segments into memory.
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment...\n");
-        for (int j = 0; j < noffH.code.size; j++){
-            char c;
-            executable->ReadAt(&c, 1, j + noffH.code.inFileAddr);
-            int vaddr  = noffH.code.virtualAddr + j; 
-            int vpn    = vaddr / PAGE_SIZE;
-            int offset = vaddr % PAGE_SIZE;
-            int ppn    = pageTable[vpn].physicalPage;
-            int pp     = ppn * PAGE_SIZE;
-            int paddr  = pp + offset;
-            machine->mainMemory[paddr] = c;
-        }
+/// The parent is the running address space: its TLB is flushed first, so
+/// that the page table has the latest bits, and no TLB entry still allows
+/// writing to pages about to be shared.  Only the pages the parent ever
+/// used are looked at.
+///
+/// Without frames managed by the coremap there is no way to share them, and
+/// the pages are copied right away.
+AddressSpace::AddressSpace(AddressSpace *parent)
+{
+    executable = parent->executable->Duplicate();
+    noffH      = parent->noffH;
+    numPages   = parent->numPages;
+#ifdef USE_TLB
+    brk         = parent->brk;
+    stackBottom = parent->stackBottom;
+    pageTable   = new PageTable(numPages, PAGE_TABLE_LEAF_PAGES);
+#else
+    pageTable   = new PageTable(numPages, numPages);
+#endif
+
+    parent->SaveState();
+#if defined(VMEM) && defined(USE_DML)
+    nextFault = 0;
+    readAhead = 0;
+#endif
+#ifdef VMEM
+    mappings     = NULL;
+    numSwapSlots = 0;
+#endif
+    PageTable *parentTable = parent->pageTable;
+    for (unsigned i = parentTable->Next(0); i < numPages;
+         i = parentTable->Next(i + 1)) {
+#if defined(VMEM) && defined(USE_DML)
+        ShareFrom(parent, i);
+        if (SwapSlot(i) != -1)
+            numSwapSlots++;
+#else
+        TranslationEntry *entry = pageTable->Entry(i);
+        *entry = *parentTable->Entry(i);
+        entry->physicalPage = vpages->Find();
+        ASSERT((int) entry->physicalPage >= 0);  // Out of memory.
+        memcpy(&machine->mainMemory[entry->physicalPage * PAGE_SIZE],
+               &machine->mainMemory[parentTable->Entry(i)->physicalPage
+                                    * PAGE_SIZE],
+               PAGE_SIZE);
+#endif
     }
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing data segment...\n");
-        for (int j = 0; j < noffH.initData.size; j++){
-            char c;
-            executable->ReadAt(&c, 1, j + noffH.initData.inFileAddr);
-            int vaddr  = noffH.initData.virtualAddr + j;
-            int vpn    = vaddr / PAGE_SIZE;
-            int offset = vaddr % PAGE_SIZE; 
-            int ppn    = pageTable[vpn].physicalPage;
-            int pp     = ppn * PAGE_SIZE;
-            int paddr  = pp + offset;
-            machine->mainMemory[paddr] = c;
-        }
+}
+
+#if defined(VMEM) && defined(USE_DML)
+/// Sharing takes the coremap lock, and the pageout daemon may evict the
+/// page of the parent while we wait for it.  In that case the page is
+/// copied again, now out of memory.
+void
+AddressSpace::ShareFrom(AddressSpace *parent, unsigned vpn)
+{
+    TranslationEntry *entry       = pageTable->Entry(vpn);
+    TranslationEntry *parentEntry = parent->pageTable->Entry(vpn);
+    int *slot = pageTable->SwapSlot(vpn);
+
+    for (;;) {
+        *entry = *parentEntry;
+        *slot  = *parent->pageTable->SwapSlot(vpn);
+        if (*slot != -1)
+            swapArea->Share(*slot);
+
+        int ppn = entry->physicalPage;
+        if (ppn < 0 || (unsigned) ppn == coremap->ZeroFrame())
+            return;  // Nothing to share, or read-only already.
+        entry->readOnly = parentEntry->readOnly = true;
+        if (coremap->Share(ppn, parent, vpn, this))
+            return;
+        if (*slot != -1)
+            swapArea->Free(*slot);
     }
+}
+#endif
+
+/// The TLB entry is dropped, so that the write is retried through a page
+/// fault, that loads the new translation.
+bool
+AddressSpace::CopyOnWrite(unsigned vpn)
+{
+#if defined(VMEM) && defined(USE_DML)
+    DropTlbEntry(vpn);
+
+    TranslationEntry *entry = pageTable->Entry(vpn);
+    if (!entry->readOnly)
+        return false;
+    DEBUG('8', "COPY ON WRITE: %u\n", vpn);
+
+    int shared = entry->physicalPage;
+    int ppn;
+    if ((unsigned) shared == coremap->ZeroFrame()) {
+        ppn = coremap->Find(this, vpn);
+        memset(&machine->mainMemory[ppn * PAGE_SIZE], 0, PAGE_SIZE);
+        entry->physicalPage = ppn;
+        entry->readOnly     = false;
+        coremap->Unpin(ppn);
+        return true;
+    }
+
+    ppn = coremap->Unshare(this, vpn, shared);
+    if (ppn == -1 || ppn == shared) {
+        // Either evicted meanwhile, and it comes back unshared, or it is
+        // not shared any more.
+        entry->readOnly = false;
+        return true;
+    }
+    entry->physicalPage = ppn;
+    entry->readOnly     = false;
+    entry->dirty        = true;
+    coremap->Unpin(ppn);
+    return true;
+#else
+    return false;
 #endif
 }
 
-/// Deallocate an address space.
+/// Pages given back are loaded again, zero filled, if used again.
+void
+AddressSpace::FreePage(unsigned vpn)
+{
+    TranslationEntry *entry = pageTable->Lookup(vpn);
+
+    if (entry == NULL)
+        return;  // Never used.
+#ifdef USE_TLB
+    TranslationEntry *tlbEntry = TlbEntry(vpn);
+    if (tlbEntry != NULL)
+        tlbEntry->valid = false;
+#endif
+    if ((int) entry->physicalPage >= 0) {
+#if defined(VMEM) && defined(USE_DML)
+        if (entry->physicalPage != coremap->ZeroFrame())
+            coremap->Free(this, vpn, entry->physicalPage);
+#else
+        vpages->Clear(entry->physicalPage);
+#endif
+    }
+#ifdef VMEM
+    int *slot = pageTable->SwapSlot(vpn);
+    if (*slot != -1) {
+        swapArea->Free(*slot);
+        numSwapSlots--;
+    }
+    *slot = -1;
+#endif
+    entry->physicalPage = -1;
+    entry->valid        = false;
+    entry->readOnly     = false;
+    entry->use          = false;
+    entry->dirty        = false;
+}
+
+/// Deallocate an address space, giving back its physical pages, its swap
+/// slots and the executable.
 ///
-/// Nothing for now!
+/// With virtual memory, the frames are given back through the list of the
+/// pages in memory; the page table is only gone through while there are
+/// swap slots left to give back.  Without it, every page is in memory.
 AddressSpace::~AddressSpace()
 {
-    unsigned i;
-    for(i=0; i < numPages; i++)
-        vpages->Clear(pageTable[i].physicalPage);
-    delete [] pageTable;
+    DEBUG('a', "Deallocating address space: %u page tables of %u pages\n",
+          pageTable->NumLeaves(), numPages);
+#if defined(VMEM) && defined(USE_DML)
+#ifdef USE_TLB
+    if (this == currentThread->space)
+        for (unsigned i = 0; i < TLB_SIZE; i++)
+            machine->tlb[i].valid = false;
+#endif
+    coremap->FreeAll(this);
+    for (unsigned i = pageTable->Next(0); numSwapSlots > 0 && i < numPages;
+         i = pageTable->Next(i + 1)) {
+        int *slot = pageTable->SwapSlot(i);
+        if (*slot != -1) {
+            swapArea->Free(*slot);
+            *slot = -1;
+            numSwapSlots--;
+        }
+    }
+#else
+    for (unsigned i = pageTable->Next(0); i < numPages;
+         i = pageTable->Next(i + 1))
+        FreePage(i);
+#endif
+    delete pageTable;
+    delete executable;
+}
+
+/// Shrinking gives back the pages past the new end.  Growing only moves the
+/// end: the new pages are zero filled when first used.  A page is left
+/// between the heap and the stack, so that running off either one faults.
+int
+AddressSpace::Sbrk(int size)
+{
+#ifdef USE_TLB
+    unsigned old   = brk;
+    unsigned start = noffH.code.size + noffH.initData.size
+                     + noffH.uninitData.size;
+
+    if (size < 0 && (unsigned) -size > brk - start)
+        return -1;  // Past the start of the heap.
+    if (size > 0 && PagesFor(brk + size) >= stackBottom)
+        return -1;  // Into the stack.
+
+    brk += size;
+    for (unsigned i = PagesFor(brk); i < PagesFor(old); i++)
+        FreePage(i);
+    DEBUG('a', "Heap ends at %u\n", brk);
+    return old;
+#else
+    return -1;  // The address space cannot grow.
+#endif
+}
+
+/// Code usually moves the stack pointer down before using the new space,
+/// but some of it writes just below, so a page of slack is allowed.  The
+/// stack must not run into the heap.
+void
+AddressSpace::GrowStack(unsigned vaddr, unsigned sp)
+{
+#ifdef USE_TLB
+    unsigned vpn = vaddr / PAGE_SIZE;
+
+    if (vpn < stackBottom && vaddr + PAGE_SIZE >= sp
+          && vpn > PagesFor(brk)) {
+        DEBUG('a', "Stack grows down to page %u\n", vpn);
+        stackBottom = vpn;
+    }
+#endif
+}
+
+bool
+AddressSpace::IsValid(unsigned vpn)
+{
+#ifdef USE_TLB
+    return vpn < PagesFor(brk)
+           || (vpn >= stackBottom && vpn < numPages);
+#else
+    return vpn < numPages;
+#endif
 }
 
 /// Set the initial values for the user-level register set.
@@ -292,7 +753,7 @@ void AddressSpace::SaveState()
     for(i = 0; i < TLB_SIZE; i++){
 	    tlb_entry = machine->tlb[i];
 	    if(tlb_entry.valid == true)
-            pageTable[machine->tlb[i].virtualPage] = tlb_entry;
+            *pageTable->Entry(machine->tlb[i].virtualPage) = tlb_entry;
         machine->tlb[i].valid = false;
     }
 #endif
@@ -301,7 +762,8 @@ void AddressSpace::SaveState()
 /// On a context switch, restore the machine state so that this address space
 /// can run.
 ///
-/// For now, tell the machine where to find the page table.
+/// For now, tell the machine where to find the page table.  Without a TLB
+/// it is a single array, starting with the entry of page 0.
 void AddressSpace::RestoreState()
 {
 #ifdef USE_TLB
@@ -310,7 +772,7 @@ unsigned i;
 for(i = 0; i < TLB_SIZE; i++)
     machine->tlb[i].valid = false;
 #else
-machine->pageTable     = pageTable;
+machine->pageTable     = pageTable->Entry(0);
 machine->pageTableSize = numPages;
 #endif
 }
@@ -318,13 +780,13 @@ machine->pageTableSize = numPages;
 
 TranslationEntry AddressSpace::bringPage(unsigned pos)
 {
-    return pageTable[pos];
+    return *pageTable->Entry(pos);
 }
 
 // Dual of bringPage
 void AddressSpace::copyPage(unsigned from, unsigned to)
 {
-    pageTable[to] = machine->tlb[from];
+    *pageTable->Entry(to) = machine->tlb[from];
 }
 
-bool AddressSpace::InvalidVPN(int vaddr) { DEBUG('5', "numPages:%d\n", numPages);return vaddr >= numPages * PAGE_SIZE; };
+bool AddressSpace::InvalidVPN(int vaddr) { DEBUG('5', "numPages:%d\n", numPages);return !IsValid(vaddr / PAGE_SIZE); };
@@ -16,12 +16,35 @@
 
 #include "filesys/file_system.hh"
 #include "machine/translation_entry.hh"
+#include "machine/statistics.hh"
 #include "bin/noff.h"
+#include "page_table.hh"
 #include <math.h>
 
 
 const unsigned USER_STACK_SIZE = 1024;  ///< Increase this as necessary!
 
+#ifdef USE_TLB
+/// With a TLB, the page table is sparse and every address space is this
+/// many pages: the heap grows up from the end of the data, the stack down
+/// from the top, and the hole in between costs nothing.
+const unsigned USER_ADDRESS_SPACE_PAGES = 1 << 17;
+
+/// Pages covered by each second-level page table.
+const unsigned PAGE_TABLE_LEAF_PAGES = 64;
+#endif
+
+#if defined(VMEM) && defined(USE_DML)
+/// On a fault, the pages in memory within the same block of this many
+/// pages are put in the TLB too.
+const unsigned FAULT_AROUND_PAGES = 8;
+
+/// Most pages read ahead of a sequential scan.
+const unsigned MAX_READ_AHEAD = 8;
+#endif
+
+
+class FrameMapping;
 
 class AddressSpace {
 public:
@@ -32,6 +55,10 @@ public:
     /// * `executable` is the open file that corresponds to the program.
     AddressSpace(OpenFile *executable);
 
+    /// Create a copy of `parent`, for `Fork`.  With virtual memory, frames
+    /// are shared read-only, and only copied when either side writes.
+    AddressSpace(AddressSpace *parent);
+
     /// De-allocate an address space.
     ~AddressSpace();
 
@@ -46,26 +73,146 @@ public:
     TranslationEntry bringPage(unsigned i);
     void copyPage(unsigned from, unsigned to);
 
-    void LoadSegment(int vaddr);
+    /// Load the page holding `vaddr` from the executable.  Unless `wait`
+    /// is set, give up and return false if there is no frame to spare.
+    /// If `read` is given, tell there whether the executable was read: it
+    /// is not for zero filled pages, nor for text already in memory.
+    bool LoadSegment(int vaddr, bool wait = true, bool *read = NULL);
 
-    void SaveToSwap(int vpn);
+    /// Load page `vpn` from swap into the pinned frame `ppn`.  The pages
+    /// after it that went out with it come back too, if there are frames
+    /// to spare.
     void LoadFromSwap(int vpn, int ppn);
 
+    /// Move the end of the heap by `size` bytes.  Return the old end, or -1
+    /// if the heap would run into the stack.  New heap pages are zero
+    /// filled on demand.
+    int Sbrk(int size);
+
+    /// Called on a fault at `vaddr`, with the stack pointer at `sp`: if the
+    /// fault is just below the stack, grow the stack down to it.
+    void GrowStack(unsigned vaddr, unsigned sp);
+
+    /// Handle a write to the read-only page `vpn`.  Return false if the page
+    /// is neither shared copy-on-write nor mapping the zero frame, and the
+    /// write is really an error.
+    bool CopyOnWrite(unsigned vpn);
+
+    /// Called by the coremap when evicting the frame of `vpn`.  First
+    /// `Unmap` removes it from the TLB and the page table and returns
+    /// whether it is dirty; then, once the frame is saved, `PagedOut`
+    /// records that the page is now in swap slot `slot`, or nowhere if -1.
+    ///
+    /// In between, the page table still names the frame, but not as valid:
+    /// a fault on the page meanwhile waits for the eviction to end (see
+    /// `Coremap::WaitForEvictions`), instead of writing to a frame already
+    /// being saved.
+
+    bool Unmap(unsigned vpn);
+    void PagedOut(unsigned vpn, int slot);
+
+    /// Swap slot holding `vpn`, or -1.
+    int SwapSlot(unsigned vpn);
+
+    /// Frame holding `vpn`, or -1 if it is not in memory.
+    int Frame(unsigned vpn);
+
+    /// Return whether `vpn` was referenced since its use bit was last
+    /// cleared.
+    bool IsReferenced(unsigned vpn);
+
+    /// Like `IsReferenced`, clearing the use bit.
+    bool TestAndClearUse(unsigned vpn);
+
+    /// Return whether `vpn` was modified since it was loaded.
+    bool IsDirty(unsigned vpn);
+
+#if defined(VMEM) && defined(USE_DML)
+    /// Called when a fault brought `vpn` into memory: if faults follow a
+    /// sequential scan, read the next pages in too.
+    void ReadAhead(unsigned vpn);
+
+    /// Called on every fault, once `vpn` is in memory and before it is put
+    /// in the TLB: put the pages around it that are in memory there too.
+    void FaultAround(unsigned vpn);
+#endif
+
+    /// Whether `vaddr` lies outside of the code, data, heap and stack.
     bool InvalidVPN(int vaddr);
+
+    /// Paging counters of this address space.
+    PagingStats paging;
+
+#ifdef VMEM
+    /// Pages of this address space in memory, as recorded by the coremap,
+    /// which keeps the list.
+    FrameMapping *mappings;
+#endif
 private:
 
-    /// Assume linear page table translation for now!
-    TranslationEntry *pageTable;
+    PageTable *pageTable;
 
     /// Number of pages in the virtual address space.
     unsigned numPages;
 
+#ifdef USE_TLB
+    /// End of the heap, as moved by `Sbrk`.
+    unsigned brk;
+    /// Lowest page of the stack.
+    unsigned stackBottom;
+#endif
+
+    /// Whether page `vpn` lies in the code, data, heap or stack.
+    bool IsValid(unsigned vpn);
+
+    /// Give back the frame and swap slot of `vpn`, if any.
+    void FreePage(unsigned vpn);
+
     /// For demand loading
     OpenFile *executable;
     NoffHeader noffH;
 
-    // SWAP
-    OpenFile *swapfile;
+#ifdef VMEM
+    /// Pages holding a swap slot.
+    unsigned numSwapSlots;
+
+    /// Make page `vpn` share the frame or swap slot of that page in
+    /// `parent`.
+    void ShareFrom(AddressSpace *parent, unsigned vpn);
+
+    /// The TLB entry mapping `vpn`, or `NULL` if there is none.
+    TranslationEntry *TlbEntry(unsigned vpn);
+
+    /// Copy the TLB entry mapping `vpn`, if any, to the page table, and
+    /// drop it from the TLB.
+    void DropTlbEntry(unsigned vpn);
+#endif
+#if defined(VMEM) && defined(USE_DML)
+    /// Where the next fault of a sequential scan would be.
+    unsigned nextFault;
+    /// Pages read ahead on the last fault.
+    unsigned readAhead;
+    /// Bring `vpn` into memory if there is a frame to spare.  Return
+    /// whether it is in memory now.
+    bool Prefetch(unsigned vpn);
+#endif
+
+    /// Copy the part of `segment` that lies in virtual page `vpn` into
+    /// physical page `ppn`, with a single read of the executable.
+    void LoadFromSegment(const Segment *segment, unsigned vpn, unsigned ppn);
+
+    /// Fill physical page `ppn` with the initial contents of virtual page
+    /// `vpn`: code and initialized data, zeroes everywhere else.
+    void LoadPage(unsigned vpn, unsigned ppn);
+
+#ifdef USE_DML
+    /// Whether page `vpn` holds nothing but code.
+    bool IsText(unsigned vpn);
+
+    /// Whether page `vpn` holds neither code nor initialized data, so that
+    /// it starts out full of zeros.
+    bool IsZeroFill(unsigned vpn);
+#endif
 };
 
 
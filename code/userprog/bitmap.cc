@@ -16,11 +16,11 @@
 /// * `nitems` is the number of bits in the bitmap.
 BitMap::BitMap(unsigned nitems)
 {
-    numBits  = nitems;
-    numWords = divRoundUp(numBits, BitsInWord);
-    map      = new unsigned [numWords];
-    for (unsigned i = 0; i < numBits; i++)
-        Clear(i);
+    numBits   = nitems;
+    numWords  = divRoundUp(numBits, BitsInWord);
+    map       = new unsigned [numWords]();
+    numClear  = numBits;
+    firstFree = 0;
 }
 
 /// De-allocate a bitmap.
@@ -36,6 +36,8 @@ void
 BitMap::Mark(unsigned which)
 {
     ASSERT(which < numBits);
+    if (!Test(which))
+        numClear--;
     map[which / BitsInWord] |= 1 << which % BitsInWord;
 }
 
@@ -46,7 +48,11 @@ void
 BitMap::Clear(unsigned which)
 {
     ASSERT(which < numBits);
+    if (Test(which))
+        numClear++;
     map[which / BitsInWord] &= ~(1 << which % BitsInWord);
+    if (which / BitsInWord < firstFree)
+        firstFree = which / BitsInWord;
 }
 
 /// Return true if the “nth” bit is set.
@@ -64,14 +70,40 @@ BitMap::Test(unsigned which)
 /// the bit (mark it as in use).  (In other words, find and allocate a bit.)
 ///
 /// If no bits are clear, return -1.
+///
+/// Whole words are skipped while they are full, starting with the first
+/// one that may not be.
 int
 BitMap::Find()
 {
-    for (unsigned i = 0; i < numBits; i++)
-        if (!Test(i)) {
-            Mark(i);
-            return i;
+    for (; firstFree < numWords; firstFree++) {
+        unsigned word = Word(firstFree);
+        if (word != ~0U) {
+            unsigned which = firstFree * BitsInWord + __builtin_ctz(~word);
+            Mark(which);
+            return which;
+        }
+    }
+    return -1;
+}
+
+/// The search starts at the first word that may have a clear bit, as for
+/// `Find`, and goes bit by bit from there.
+int
+BitMap::FindRun(unsigned count)
+{
+    unsigned run = 0;
+
+    ASSERT(count > 0);
+    for (unsigned i = firstFree * BitsInWord; i < numBits; i++) {
+        run = Test(i) ? 0 : run + 1;
+        if (run == count) {
+            unsigned first = i + 1 - count;
+            for (unsigned j = first; j <= i; j++)
+                Mark(j);
+            return first;
         }
+    }
     return -1;
 }
 
@@ -80,12 +112,26 @@ BitMap::Find()
 unsigned
 BitMap::NumClear()
 {
-    unsigned count = 0;
+    return numClear;
+}
 
-    for (unsigned i = 0; i < numBits; i++)
-        if (!Test(i))
-            count++;
-    return count;
+unsigned
+BitMap::Word(unsigned w)
+{
+    unsigned past = numBits - w * BitsInWord;  // Bits of this word in use.
+
+    if (past >= BitsInWord)
+        return map[w];
+    return map[w] | ~0U << past;
+}
+
+void
+BitMap::Recount()
+{
+    numClear = 0;
+    for (unsigned w = 0; w < numWords; w++)
+        numClear += __builtin_popcount(~Word(w));
+    firstFree = 0;
 }
 
 /// Print the contents of the bitmap, for debugging.
@@ -111,6 +157,7 @@ void
 BitMap::FetchFrom(OpenFile *file)
 {
     file->ReadAt((char *) map, numWords * sizeof (unsigned), 0);
+    Recount();
 }
 
 /// Store the contents of a bitmap to a Nachos file.
@@ -61,6 +61,12 @@ public:
     /// If no bits are clear, return -1.
     int Find();
 
+    /// Return the first of `count` consecutive clear bits, and as a side
+    /// effect, set them all.
+    ///
+    /// If there are not so many clear bits in a row, return -1.
+    int FindRun(unsigned count);
+
     /// Return the number of clear bits.
     unsigned NumClear();
 
@@ -91,6 +97,18 @@ private:
     /// Bit storage.
     unsigned *map;
 
+    /// Number of clear bits.
+    unsigned numClear;
+
+    /// No word before this one has a clear bit.
+    unsigned firstFree;
+
+    /// Word `w` of the map, with the bits past `numBits` set.
+    unsigned Word(unsigned w);
+
+    /// Compute `numClear` and `firstFree` again, after the map is read.
+    void Recount();
+
 };
 
 
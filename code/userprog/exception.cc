@@ -31,9 +31,12 @@
 
 void IncreasePC();
 void StartProc(void *);
+void ForkedProc(void *);
 SpaceId NewPid(Thread *);
 void RemovePid(SpaceId);
 void insertTLB(TranslationEntry entry);
+void CountFault(bool major, unsigned start);
+void ExitProcess(int status);
 
 /// Entry point into the Nachos kernel.  Called when a user program is
 /// executing, and either does a syscall, or generates an addressing or
@@ -172,18 +175,24 @@ ExceptionHandler(ExceptionType which)
             case SC_Exit:
             {
                 int status = machine->ReadRegister(4);
-                currentThread->CloseAllFiles();
-                //Terminate the thread
-                currentThread->Finish(status);
-                stats->Print();
+                ExitProcess(status);
                 break;
             }
 
             case SC_Join:
             {
                 SpaceId pid = machine->ReadRegister(4);
+                if(pid <= 0 || pid >= MAX_NPROCS || ptable[pid] == NULL
+                   || ptable[pid] == currentThread){
+                    //No such process, or already joined
+                    machine->WriteRegister(2, -1);
+                    IncreasePC();
+                    break;
+                }
                 Thread *t = ptable[pid];
                 t->Join();
+                delete t;
+                RemovePid(pid);
                 machine->WriteRegister(2, 0);
                 IncreasePC();
                 break;
@@ -200,8 +209,19 @@ ExceptionHandler(ExceptionType which)
                 SpaceId pid = -1;
                 if(exec!=NULL){
                     //All threads will start as joineable
-                    Thread *t = new Thread(strdup(name), 0, true);
+                    char *tname = strdup(name);
+                    Thread *t = new Thread(tname, DEFAULT_PRIORITY, true);
+                    t->setTickets(currentThread->getTickets());
                     pid = NewPid(t);
+                    if(pid == -1){
+                        //The process table is full
+                        delete t;
+                        free(tname);
+                        delete exec;
+                        machine->WriteRegister(2, pid);
+                        IncreasePC();
+                        break;
+                    }
                     AddressSpace *as = new AddressSpace(exec);
                     t->space = as;
                     char **args = SaveArgs(pargs);
@@ -212,35 +232,129 @@ ExceptionHandler(ExceptionType which)
                 IncreasePC();
                 break;
             }
+
+            case SC_Fork:
+            {
+                //The child starts with the registers of the parent, right
+                //after the syscall, but gets 0 as result
+                IncreasePC();
+                char *tname = strdup(currentThread->getName());
+                Thread *t = new Thread(tname, DEFAULT_PRIORITY, true);
+                t->setTickets(currentThread->getTickets());
+                SpaceId pid = NewPid(t);
+                if(pid == -1){
+                    //The process table is full
+                    delete t;
+                    free(tname);
+                    machine->WriteRegister(2, pid);
+                    break;
+                }
+                AddressSpace *as = new AddressSpace(currentThread->space);
+                machine->WriteRegister(2, 0);
+                t->SaveUserState();
+                machine->WriteRegister(2, pid);
+                t->Fork(ForkedProc, as);
+                break;
+            }
+
+            case SC_Sbrk:
+            {
+                int size = machine->ReadRegister(4);
+                machine->WriteRegister(2, currentThread->space->Sbrk(size));
+                IncreasePC();
+                break;
+            }
+
+            case SC_SetTickets:
+            {
+                int tickets = machine->ReadRegister(4);
+                if (tickets < 1 || (unsigned) tickets > MAX_TICKETS)
+                    machine->WriteRegister(2, -1);
+                else {
+                    machine->WriteRegister(2, currentThread->getTickets());
+                    currentThread->setTickets(tickets);
+                }
+                IncreasePC();
+                break;
+            }
+
+            case SC_GetStats:
+            {
+                // Both are copied word by word.
+                ASSERT(sizeof (PagingStats) == sizeof (PagingInfo));
+                int process = machine->ReadRegister(4);
+                int system  = machine->ReadRegister(5);
+                if (process != 0)
+                    WriteWordsToUser((unsigned *) &currentThread->space->paging,
+                                     process,
+                                     sizeof (PagingInfo) / sizeof (unsigned));
+                if (system != 0)
+                    WriteWordsToUser((unsigned *) &stats->paging, system,
+                                     sizeof (PagingInfo) / sizeof (unsigned));
+                IncreasePC();
+                break;
+            }
         }
 
     } else if (which == PAGE_FAULT_EXCEPTION){
         DEBUG('b', "Page fault exception encountered \n");
         int vaddr = machine->registers[BAD_VADDR_REG];
         int vpn   = vaddr/PAGE_SIZE;
+#ifdef USE_TLB
+        currentThread->space->GrowStack(vaddr, machine->ReadRegister(STACK_REG));
+#endif
         if((vaddr < 0) || currentThread->space->InvalidVPN(vaddr)){
             DEBUG('b', "Page fault exception error in address %d\n", vaddr);
             ASSERT(false);
         }
+        unsigned start   = stats->totalTicks;
+#ifdef VMEM
+        // A page with a frame, but not valid, is being written to swap.
+        TranslationEntry entry = currentThread->space->bringPage(vpn);
+        if (!entry.valid && (int) entry.physicalPage >= 0)
+            coremap->WaitForEvictions();
+#endif
+        // Not in memory, as opposed to just missing from the TLB.
+        bool     missing =
+            (int) currentThread->space->bringPage(vpn).physicalPage < 0;
+        bool     read    = false;
 #ifdef USE_DML
         if(currentThread->space->bringPage(vpn).physicalPage == -1){
-            currentThread->space->LoadSegment(vaddr);
+            stats->numPageFaults++;
+            currentThread->space->LoadSegment(vaddr, true, &read);
         }
 #endif
 #ifdef VMEM
         //If its on SWAP, load it
         if(currentThread->space->bringPage(vpn).physicalPage == -2){
             //Find a position and store info in coremap
+            stats->numPageFaults++;
             int ppn = coremap->Find(currentThread->space, vpn);
             currentThread->space->LoadFromSwap(vpn,ppn);
-            /*TODO: leer de carpeta*/
+            read = true;
         }
 #endif
+#if defined(VMEM) && defined(USE_DML)
+        if (missing)
+            currentThread->space->ReadAhead(vpn);
+        currentThread->space->FaultAround(vpn);
+#endif
+        if (missing)
+            CountFault(read, start);
+        else {
+            stats->paging.tlbRefills++;
+            currentThread->space->paging.tlbRefills++;
+        }
+        // Nothing may switch threads from here on: that would empty the TLB.
         insertTLB(currentThread->space->bringPage(vpn));
 
     } else if (which == READ_ONLY_EXCEPTION){
         DEBUG('b', "Read only exception encountered \n");
-        currentThread->Finish(1);
+        int vpn = machine->registers[BAD_VADDR_REG] / PAGE_SIZE;
+        unsigned start = stats->totalTicks;
+        if (!currentThread->space->CopyOnWrite(vpn))
+            ExitProcess(1);
+        CountFault(false, start);
 
     } else {
         printf("Unexpected user mode exception %d %d\n", which, type);
@@ -272,6 +386,33 @@ StartProc(void *args)
 }
 
 
+/// The child may be switched out before it gets here; the address space is
+/// only set now, so that the scheduler does not save the registers of
+/// whoever ran last over the ones copied from the parent.
+void
+ForkedProc(void *space)
+{
+    currentThread->space = (AddressSpace *) space;
+    currentThread->RestoreUserState();
+    currentThread->space->RestoreState();
+
+    machine->Run();
+}
+
+
+/// Tear down the current process, as `Exit` does, and finish its thread
+/// with `status`.
+void
+ExitProcess(int status)
+{
+    currentThread->CloseAllFiles();
+    delete currentThread->space;
+    currentThread->space = NULL;
+    //Terminate the thread
+    currentThread->Finish(status);
+}
+
+
 //PTABLE FUNCTIONS
 SpaceId
 NewPid(Thread *t)
@@ -292,6 +433,26 @@ RemovePid(SpaceId p)
 }
 
 
+/// Count a fault of the current process, that started being served at
+/// tick `start`.
+void
+CountFault(bool major, unsigned start)
+{
+    PagingStats *global = &stats->paging;
+    PagingStats *local  = &currentThread->space->paging;
+
+    if (major) {
+        global->majorFaults++;
+        local->majorFaults++;
+    } else {
+        global->minorFaults++;
+        local->minorFaults++;
+    }
+    global->RecordFault(stats->totalTicks - start);
+    local->RecordFault(stats->totalTicks - start);
+}
+
+
 //TLB FUNCTIONS
 void
 insertTLB(TranslationEntry entry)
@@ -0,0 +1,62 @@
+/// Routines to hand out the frames of physical memory.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "frame_allocator.hh"
+
+
+FrameAllocator::FrameAllocator(unsigned numFrames_)
+{
+    numFrames = numFrames_;
+    numFree   = numFrames;
+    next      = new int [numFrames];
+    for (unsigned i = 0; i < numFrames; i++)
+        next[i] = i + 1 < numFrames ? (int) i + 1 : -1;
+    first = numFrames > 0 ? 0 : -1;
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    delete [] next;
+}
+
+int
+FrameAllocator::Find()
+{
+    int ppn = first;
+
+    if (ppn != -1) {
+        first     = next[ppn];
+        next[ppn] = IN_USE;
+        numFree--;
+    }
+    return ppn;
+}
+
+/// The frame goes first in the list: it is the one most likely to still be
+/// in the host cache.
+void
+FrameAllocator::Clear(unsigned ppn)
+{
+    ASSERT(Test(ppn));
+    next[ppn] = first;
+    first     = ppn;
+    numFree++;
+}
+
+bool
+FrameAllocator::Test(unsigned ppn)
+{
+    ASSERT(ppn < numFrames);
+    return next[ppn] == IN_USE;
+}
+
+unsigned
+FrameAllocator::NumClear()
+{
+    return numFree;
+}
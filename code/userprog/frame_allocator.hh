@@ -0,0 +1,57 @@
+/// Data structures to hand out the frames of physical memory.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_FRAMEALLOCATOR__HH
+#define NACHOS_USERPROG_FRAMEALLOCATOR__HH
+
+
+#include "threads/utility.hh"
+
+
+/// The free frames of physical memory, in a list kept in an array beside
+/// them, with an entry per frame: each free frame has the number of the
+/// next one.  The frames themselves are not touched.  Taking a frame and
+/// giving it back cost the same whatever the size of memory, unlike
+/// searching a bitmap.
+///
+/// The operations are named as those of `BitMap`, that it replaces: a frame
+/// in use is a set bit.
+class FrameAllocator {
+public:
+
+    /// Manage `numFrames` frames, all free.  They are handed out in order
+    /// at first.
+    FrameAllocator(unsigned numFrames);
+
+    ~FrameAllocator();
+
+    /// Take a free frame and return it, or -1 if there is none.
+    int Find();
+
+    /// Give back frame `ppn`.
+    void Clear(unsigned ppn);
+
+    /// Is frame `ppn` in use?
+    bool Test(unsigned ppn);
+
+    /// Number of free frames.
+    unsigned NumClear();
+
+private:
+    unsigned numFrames;
+    unsigned numFree;
+
+    /// For each free frame, the next one in the list, or -1 for the last.
+    /// Frames in use hold `IN_USE`.
+    int *next;
+    int first;  ///< First free frame, or -1.
+
+    static const int IN_USE = -2;
+};
+
+
+#endif
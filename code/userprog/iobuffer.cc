@@ -7,10 +7,12 @@
 #include "iobuffer.hh"
 
 
-// Llamamos dos veces porque en el primer acceso puede haber un TLB miss
+// Reintentamos hasta que el acceso funcione: cada falla es un TLB miss o
+// una copia en escritura, que resuelve el manejador de excepciones, y con
+// pocos marcos la pagina puede ser desalojada otra vez antes de reintentar
 #ifdef USE_TLB
-#define READMEM(addr, size, val) if (!machine->ReadMem((unsigned)addr, (unsigned)size, (int*)val)) ASSERT(machine->ReadMem((unsigned)addr, (unsigned)size, (int*)val)) 
-#define WRITEMEM(addr,size,val) if (!machine->WriteMem((unsigned)addr, (unsigned)size, (int)val)) ASSERT(machine->WriteMem((unsigned)addr,(unsigned)size,(int)val))
+#define READMEM(addr, size, val) while (!machine->ReadMem((unsigned)addr, (unsigned)size, (int*)val)) {}
+#define WRITEMEM(addr,size,val) while (!machine->WriteMem((unsigned)addr, (unsigned)size, (int)val)) {}
 
 #else
 
@@ -124,3 +126,11 @@ SpareWriteBufferToUser(const char *buf, int addr, unsigned count)
             break;
     }
 }
+
+// Write words to a machine memory space, one at a time
+void
+WriteWordsToUser(const unsigned *words, int addr, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        WRITEMEM(addr + 4 * i, 4, words[i]);
+}
@@ -16,4 +16,9 @@ WriteStringToUser(const char *string, int userAddress);
 void 
 WriteBufferToUser(const char* buffer, int userAddress, unsigned byteCount);
 
+// Write `count` words to user memory, in the byte order of the machine
+// (The address is assumed to be 4 byte aligned)
+void
+WriteWordsToUser(const unsigned *words, int userAddress, unsigned count);
+
 #endif //__IOBUFFER_H_
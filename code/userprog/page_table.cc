@@ -0,0 +1,105 @@
+/// Routines to manage two-level page tables.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "page_table.hh"
+
+
+PageTable::PageTable(unsigned numPages_, unsigned leafPages_)
+{
+    ASSERT(numPages_ > 0 && leafPages_ > 0);
+    numPages  = numPages_;
+    leafPages = leafPages_;
+    numLeaves = 0;
+
+    unsigned dirSize = divRoundUp(numPages, leafPages);
+    entries = new TranslationEntry * [dirSize]();
+#ifdef VMEM
+    swapSlots = new int * [dirSize]();
+#endif
+}
+
+PageTable::~PageTable()
+{
+    unsigned dirSize = divRoundUp(numPages, leafPages);
+
+    for (unsigned leaf = 0; leaf < dirSize; leaf++) {
+        delete [] entries[leaf];
+#ifdef VMEM
+        delete [] swapSlots[leaf];
+#endif
+    }
+    delete [] entries;
+#ifdef VMEM
+    delete [] swapSlots;
+#endif
+}
+
+void
+PageTable::MakeLeaf(unsigned leaf)
+{
+    TranslationEntry *table = new TranslationEntry [leafPages];
+
+    for (unsigned i = 0; i < leafPages; i++) {
+        table[i].virtualPage  = leaf * leafPages + i;
+        table[i].physicalPage = -1;
+        table[i].valid        = false;
+        table[i].readOnly     = false;
+        table[i].use          = false;
+        table[i].dirty        = false;
+    }
+    entries[leaf] = table;
+#ifdef VMEM
+    swapSlots[leaf] = new int [leafPages];
+    for (unsigned i = 0; i < leafPages; i++)
+        swapSlots[leaf][i] = -1;
+#endif
+    numLeaves++;
+}
+
+TranslationEntry *
+PageTable::Entry(unsigned vpn)
+{
+    ASSERT(vpn < numPages);
+
+    unsigned leaf = vpn / leafPages;
+    if (entries[leaf] == NULL)
+        MakeLeaf(leaf);
+    return &entries[leaf][vpn % leafPages];
+}
+
+TranslationEntry *
+PageTable::Lookup(unsigned vpn)
+{
+    ASSERT(vpn < numPages);
+
+    TranslationEntry *table = entries[vpn / leafPages];
+    return table != NULL ? &table[vpn % leafPages] : NULL;
+}
+
+#ifdef VMEM
+int *
+PageTable::SwapSlot(unsigned vpn)
+{
+    Entry(vpn);  // Make the second-level table.
+    return &swapSlots[vpn / leafPages][vpn % leafPages];
+}
+#endif
+
+unsigned
+PageTable::Next(unsigned vpn)
+{
+    while (vpn < numPages && entries[vpn / leafPages] == NULL)
+        vpn = (vpn / leafPages + 1) * leafPages;
+    return vpn < numPages ? vpn : numPages;
+}
+
+unsigned
+PageTable::NumLeaves()
+{
+    return numLeaves;
+}
@@ -0,0 +1,70 @@
+/// Data structures to translate the virtual pages of an address space.
+///
+/// The table has two levels: a directory, and second-level tables of
+/// `leafPages` entries each, only made when some page they cover is first
+/// used.  An address space that is mostly a hole, between its heap and its
+/// stack, only pays for the pages around the parts it uses.
+///
+/// Without a TLB the hardware walks the table itself, so it must be a
+/// single array: the table is then made of one second-level table, covering
+/// every page.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_PAGETABLE__HH
+#define NACHOS_USERPROG_PAGETABLE__HH
+
+
+#include "machine/translation_entry.hh"
+
+
+class PageTable {
+public:
+
+    /// Create a table for `numPages` pages, in second-level tables of
+    /// `leafPages` entries.  No second-level table is made yet.
+    PageTable(unsigned numPages, unsigned leafPages);
+
+    ~PageTable();
+
+    /// Return the entry of `vpn`, making its second-level table if needed.
+    /// New entries are not valid, and not loaded (physical page -1).
+    TranslationEntry *Entry(unsigned vpn);
+
+    /// Return the entry of `vpn`, or `NULL` if it was never made.
+    TranslationEntry *Lookup(unsigned vpn);
+
+#ifdef VMEM
+    /// Return where the swap slot of `vpn` is kept; -1 at first.
+    int *SwapSlot(unsigned vpn);
+#endif
+
+    /// Return the first page from `vpn` on with an entry, or the number of
+    /// pages if there is none.  Goes through the pages that were ever used:
+    ///
+    ///     for (vpn = Next(0); vpn < numPages; vpn = Next(vpn + 1))
+    unsigned Next(unsigned vpn);
+
+    /// Number of second-level tables made so far.
+    unsigned NumLeaves();
+
+private:
+    unsigned numPages;
+    unsigned leafPages;  ///< Entries in each second-level table.
+    unsigned numLeaves;  ///< Second-level tables made so far.
+
+    /// The directory: second-level tables, or `NULL` where not made yet.
+    TranslationEntry **entries;
+#ifdef VMEM
+    int **swapSlots;  ///< Swap slot of each page, next to its entry.
+#endif
+
+    /// Make the second-level table number `leaf`.
+    void MakeLeaf(unsigned leaf);
+};
+
+
+#endif
@@ -2,6 +2,7 @@
 //
 
 #include "synch_console.hh"
+#include "threads/system.hh"
 
 // Constructor. Create instances of lock and console.
 // Use arguments as NULL to read from stdin and write to stdout
@@ -31,6 +32,7 @@ SynchConsole::ReadChar()
 {
     readLock->Acquire();
     //Wait for character to arrive
+    scheduler->BlocksOnIO(currentThread);
     readSem->P();
     char c = console->GetChar();
     readLock->Release();
@@ -44,6 +46,7 @@ SynchConsole::WriteChar(char c)
     writeLock->Acquire();
     console->PutChar(c);
     //Wait for write to finish
+    scheduler->BlocksOnIO(currentThread);
     writeSem->P();
     writeLock->Release();
 }
@@ -30,6 +30,9 @@
 #define SC_Close    8
 #define SC_Fork     9
 #define SC_Yield   10
+#define SC_Sbrk    11
+#define SC_GetStats 12
+#define SC_SetTickets 13
 
 
 #ifndef IN_ASM
@@ -47,7 +50,7 @@
 void Halt();
 
 
-/// Address space control operations: `Exit`, `Exec`, and `Join`.
+/// Address space control operations: `Exit`, `Exec`, `Fork` and `Join`.
 
 /// This user program is done (`status = 0` means exited normally).
 void Exit(int status);
@@ -61,9 +64,24 @@ SpaceId Exec(char *name, char **args);
 
 /// Only return once the the user program `id` has finished.
 ///
-/// Return the exit status.
+/// Return the exit status, or -1 if there is no program `id` to wait for:
+/// never started, already joined, or the caller itself.
 int Join(SpaceId id);
 
+/// Create a new process, running the same program as the current one, from
+/// the same point, on a copy of its address space -- UNIX `fork`.
+///
+/// Return the `SpaceId` of the child to the parent, and 0 to the child.  The
+/// child can be waited for with `Join`.  It starts with no open files.
+SpaceId Fork(void);
+
+/// Move the end of the heap, right after the data, by `size` bytes -- UNIX
+/// `sbrk`.  New heap pages are zero filled; pages given back lose their
+/// contents.  The stack grows on its own, down towards the heap.
+///
+/// Return the previous end of the heap, or -1 if it cannot be moved.
+int Sbrk(int size);
+
 
 /// File system operations: `Create`, `Open`, `Read`, `Write`, `Close`.
 ///
@@ -107,17 +125,46 @@ int Read(char *buffer, int size, OpenFileId id);
 void Close(OpenFileId id);
 
 
-/// User-level thread operations: `Fork` and `Yield`.  To allow multiple
-/// threads to run within a user program.
-
-/// Fork a thread to run a procedure (`func`) in the *same* address space as
-/// the current thread.
-void Fork(void (*func)());
+/// User-level thread operations: `Yield`, `SetTickets`.
 
 /// Yield the CPU to another runnable thread, whether in this address space
 /// or not.
 void Yield();
 
+/// Give this process `tickets` tickets, from 1 to 10000: under the stride
+/// scheduler, processes share the CPU in proportion to them.  They start
+/// with 100, or those of the process that created them with `Exec` or
+/// `Fork`.
+///
+/// Return the tickets it had, or -1 if `tickets` is out of range.
+int SetTickets(int tickets);
+
+
+/// Instrumentation: `GetStats`.
+
+/// Buckets in the histogram of fault service times.
+#define PAGING_HISTOGRAM_BUCKETS 12
+
+/// Paging counters, as kept by the kernel.
+typedef struct {
+    unsigned tlbRefills;        ///< Faults on pages already in memory.
+    unsigned minorFaults;       ///< Faults that read nothing in.
+    unsigned majorFaults;       ///< Faults that read the executable or swap.
+    unsigned swapIns;           ///< Pages read back from swap.
+    unsigned swapOuts;          ///< Pages written to swap.
+    unsigned evictions;         ///< Pages taken away.
+    unsigned clusterEvictions;  ///< Of those, taken along with a neighbour.
+
+    /// Minor and major faults by service time: the first bucket counts
+    /// those taking less than 16 ticks, and each one after it doubles the
+    /// limit, but the last that has no limit.
+    unsigned faultTicks[PAGING_HISTOGRAM_BUCKETS];
+} PagingInfo;
+
+/// Copy the paging counters of this process into `process`, and those of
+/// the whole system into `system`.  Either may be null, to skip it.
+void GetStats(PagingInfo *process, PagingInfo *system);
+
 #endif
 
 
@@ -0,0 +1,115 @@
+/// Routines to compress and decompress pages.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "compress.hh"
+#include "threads/utility.hh"
+
+#include <string.h>
+
+
+static const unsigned MIN_MATCH    = 3;
+static const unsigned MAX_MATCH    = 127 + MIN_MATCH;
+static const unsigned MAX_DISTANCE = 256;
+static const unsigned MAX_LITERALS = 128;
+static const unsigned HASH_SIZE    = 64;
+
+static inline unsigned
+Hash(const char *p)
+{
+    unsigned x = (unsigned char) p[0] | (unsigned char) p[1] << 8
+                 | (unsigned char) p[2] << 16;
+    return (x * 2654435761u) >> 26;  // Top 6 bits: `HASH_SIZE` buckets.
+}
+
+/// Emit the `count` literals that end at `end`.  Return false if they do
+/// not fit.
+static bool
+PutLiterals(const char *end, unsigned count,
+            char *into, unsigned *out, unsigned room)
+{
+    if (count == 0)
+        return true;
+    if (*out + 1 + count > room)
+        return false;
+    into[(*out)++] = count - 1;
+    memcpy(&into[*out], end - count, count);
+    *out += count;
+    return true;
+}
+
+unsigned
+Compress(const char *from, unsigned length, char *into, unsigned room)
+{
+    int last[HASH_SIZE];
+    unsigned in = 0, out = 0, literals = 0;
+
+    for (unsigned i = 0; i < HASH_SIZE; i++)
+        last[i] = -1;
+
+    while (in < length) {
+        unsigned match = 0, distance = 0;
+
+        if (in + MIN_MATCH <= length) {
+            unsigned h = Hash(&from[in]);
+            int candidate = last[h];
+            last[h] = in;
+            if (candidate != -1 && in - candidate <= MAX_DISTANCE) {
+                distance = in - candidate;
+                while (in + match < length && match < MAX_MATCH
+                       && from[candidate + match] == from[in + match])
+                    match++;
+            }
+        }
+
+        if (match >= MIN_MATCH) {
+            if (!PutLiterals(&from[in], literals, into, &out, room)
+                  || out + 2 > room)
+                return 0;
+            literals = 0;
+            into[out++] = 0x80 | (match - MIN_MATCH);
+            into[out++] = distance - 1;
+            in += match;
+        } else {
+            in++;
+            if (++literals == MAX_LITERALS) {
+                if (!PutLiterals(&from[in], literals, into, &out, room))
+                    return 0;
+                literals = 0;
+            }
+        }
+    }
+    if (!PutLiterals(&from[in], literals, into, &out, room))
+        return 0;
+    return out;
+}
+
+void
+Decompress(const char *from, unsigned length, char *into, unsigned size)
+{
+    unsigned in = 0, out = 0;
+
+    while (in < length) {
+        unsigned char c = from[in++];
+
+        if (c < 0x80) {
+            unsigned count = c + 1;
+            ASSERT(in + count <= length && out + count <= size);
+            memcpy(&into[out], &from[in], count);
+            in  += count;
+            out += count;
+        } else {
+            ASSERT(in < length);
+            unsigned count    = c - 0x80 + MIN_MATCH;
+            unsigned distance = (unsigned char) from[in++] + 1;
+            ASSERT(distance <= out && out + count <= size);
+            for (unsigned i = 0; i < count; i++, out++)
+                into[out] = into[out - distance];
+        }
+    }
+    ASSERT(out == size);
+}
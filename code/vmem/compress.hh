@@ -0,0 +1,37 @@
+/// A small LZ77 codec, to keep swapped out pages compressed in memory.
+///
+/// It favours speed over ratio: matches are found through a hash table of
+/// the last position of each 3-byte sequence, and taken greedily.  Pages
+/// are small, and the pages worth keeping in memory are mostly zeros and
+/// repeated words, which it handles well.
+///
+/// The compressed data is a sequence of items, each starting with a
+/// control byte `c`:
+///
+/// * `c < 128`: a run of `c + 1` literal bytes follows.
+/// * `c >= 128`: a copy of `c - 128 + MIN_MATCH` bytes from the data
+///   already decoded; the next byte is the distance back, minus one.  The
+///   copy may overlap the bytes it produces, as in runs.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_COMPRESS__HH
+#define NACHOS_VMEM_COMPRESS__HH
+
+
+/// Compress `length` bytes from `from` into `into`, of `room` bytes.
+///
+/// Return the size of the compressed data, or 0 if it does not fit.
+unsigned Compress(const char *from, unsigned length,
+                  char *into, unsigned room);
+
+/// Decompress `length` bytes from `from`, that must give exactly `size`
+/// bytes, into `into`.
+void Decompress(const char *from, unsigned length,
+                char *into, unsigned size);
+
+
+#endif
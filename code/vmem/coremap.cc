@@ -2,105 +2,599 @@
 //
 
 #include "coremap.hh"
+#include "threads/system.hh"
 
-Coremap::Coremap(int n) : BitMap(n)
+Coremap::Coremap(unsigned numFrames_, const char *policyName)
 {
-    nitems = n;
-    nextVictim = -1;
-    lastVictim = 0;
+    ASSERT(numFrames_ > 0 && numFrames_ < machine->numPhysPages);
+    numFrames   = numFrames_;
+    freeFrames  = new FrameAllocator(numFrames);
+    maps        = new FrameMapping * [numFrames]();
+    pinned      = new unsigned [numFrames]();
+    texts       = new TextPage [numFrames];
+    textBuckets = new int [numFrames];
+    for (unsigned i = 0; i < numFrames; i++) {
+        texts[i].valid = false;
+        textBuckets[i] = -1;
+    }
+
+    zeroFrame = numFrames;
+    memset(&machine->mainMemory[zeroFrame * PAGE_SIZE], 0, PAGE_SIZE);
+    policy = NewReplacementPolicy(policyName, this);
+    ASSERT(policy != NULL);  // Unknown replacement policy.
+
+    // With very few frames, keeping some free would only cause thrashing:
+    // the low watermark is then 0, and the daemon only runs on demand.
+    highWater = numFrames / 4 > 0 ? numFrames / 4 : 1;
+    lowWater  = numFrames / 8;
+    victims   = new unsigned [highWater];
+    runs      = new unsigned [highWater];
+    numWaiting  = 0;
+    lock        = new Lock("coremap");
+    lowOnFrames = new Condition("coremap low on frames", lock);
+    framesFreed = new Condition("coremap frames freed", lock);
+    framesUnpinned = new Condition("coremap frames unpinned", lock);
+}
+
+Coremap::~Coremap()
+{
+    delete framesUnpinned;
+    delete framesFreed;
+    delete lowOnFrames;
+    delete lock;
+    delete policy;
+    for (unsigned i = 0; i < numFrames; i++)
+        while (maps[i] != NULL)
+            RemoveMapping(&maps[i]);
+    delete [] runs;
+    delete [] victims;
+    delete freeFrames;
+    delete [] textBuckets;
+    delete [] texts;
+    delete [] pinned;
+    delete [] maps;
+}
+
+static void
+PageoutThread(void *arg)
+{
+    coremap->Pageout();
+}
+
+void
+Coremap::StartPageout()
+{
+    Thread *daemon = new Thread("pageout", SCHEDULER_PRIORITY_NUMBER - 1);
+
+    daemon->Fork(PageoutThread, NULL);
+}
+
+unsigned
+Coremap::WaitForFrame()
+{
+    int free;
+
+    while ((free = freeFrames->Find()) == -1) {
+        lowOnFrames->Signal();
+        numWaiting++;
+        framesFreed->Wait();
+        numWaiting--;
+    }
+    if (freeFrames->NumClear() < lowWater)
+        lowOnFrames->Signal();
+    pinned[free] = 1;
+    policy->Loaded(free);
+    return free;
+}
+
+void
+Coremap::Release(unsigned ppn)
+{
+    freeFrames->Clear(ppn);
+    pinned[ppn] = 0;
+    UncacheText(ppn);
+    policy->Freed(ppn);
+}
+
+void
+Coremap::AddMapping(unsigned ppn, AddressSpace *space, unsigned vpn)
+{
+    FrameMapping *map = new FrameMapping;
+
+    map->space = space;
+    map->vpn   = vpn;
+    map->ppn   = ppn;
+    map->next  = maps[ppn];
+    maps[ppn]  = map;
+
+    map->prevInSpace = NULL;
+    map->nextInSpace = space->mappings;
+    if (space->mappings != NULL)
+        space->mappings->prevInSpace = map;
+    space->mappings = map;
+}
+
+void
+Coremap::RemoveMapping(FrameMapping **link)
+{
+    FrameMapping *map = *link;
+
+    *link = map->next;
+    if (map->prevInSpace != NULL)
+        map->prevInSpace->nextInSpace = map->nextInSpace;
+    else
+        map->space->mappings = map->nextInSpace;
+    if (map->nextInSpace != NULL)
+        map->nextInSpace->prevInSpace = map->prevInSpace;
+    delete map;
+}
+
+FrameMapping **
+Coremap::FindMapping(unsigned ppn, AddressSpace *space, unsigned vpn)
+{
+    FrameMapping **map = &maps[ppn];
+
+    while (*map != NULL && ((*map)->space != space || (*map)->vpn != vpn))
+        map = &(*map)->next;
+    return map;
 }
 
 int
-Coremap::Find(AddressSpace *own, unsigned vpn)
+Coremap::Find(AddressSpace *own, unsigned vpn, bool wait)
 {
-    int free = BitMap::Find();
-    if(free == -1){ //Push victim to swap and take its place
-        int victim = SelectVictim();
-        DEBUG('p', "Victim NUMBER: %d\n", victim);
-        ASSERT((0 <= victim) && (victim < nitems));
-//        owner[victim] -> SaveToSwap(ppnToVpn[victim]);
-        free = victim;
-        owner[free]->SaveToSwap(ppnToVpn[free]);
+    int free = -1;
+
+    lock->Acquire();
+    if (wait || freeFrames->NumClear() > lowWater) {
+        free = WaitForFrame();
+        AddMapping(free, own, vpn);
     }
-    owner[free] = own;
-    ppnToVpn[free] = vpn;
+    lock->Release();
     return free;
 }
-// Politica reloj mejorado.
-// Falta poner en used y dirty cuando corresponda
-// Seria bueno guardar la pagina en swap cuando 
-//  se la carga, para asi no estar escribiendo
-//  a cada rato. Se guardaria solo si esta dirty
-/*    
+
+int *
+Coremap::TextBucket(unsigned file, unsigned vpn)
+{
+    return &textBuckets[(file * 31 + vpn) % numFrames];
+}
+
 int
-Coremap::SelectVictim()
-{
-    int i, index, lastone = (lastVictim + NUM_PHYS_PAGES);
-    for(index=lastVictim+1; index < lastone; index++){
-        i = index % NUM_PHYS_PAGES; 
-        if (ppnstat[i].used)
-            ppnstat[i].used = false;
-        else if (ppnstat[i].dirty)
-            ;
-        else{
-            lastVictim = i; 
-            return i;
+Coremap::CachedText(unsigned file, unsigned vpn)
+{
+    int ppn = *TextBucket(file, vpn);
+
+    while (ppn != -1 && (texts[ppn].file != file || texts[ppn].vpn != vpn))
+        ppn = texts[ppn].next;
+    return ppn;
+}
+
+void
+Coremap::CacheText(unsigned ppn, unsigned file, unsigned vpn)
+{
+    int *bucket = TextBucket(file, vpn);
+
+    ASSERT(!texts[ppn].valid);
+    texts[ppn].valid = true;
+    texts[ppn].file  = file;
+    texts[ppn].vpn   = vpn;
+    texts[ppn].next  = *bucket;
+    *bucket = ppn;
+}
+
+void
+Coremap::UncacheText(unsigned ppn)
+{
+    if (!texts[ppn].valid)
+        return;
+
+    int *link = TextBucket(texts[ppn].file, texts[ppn].vpn);
+    while (*link != (int) ppn)
+        link = &texts[*link].next;
+    *link = texts[ppn].next;
+    texts[ppn].valid = false;
+}
+
+int
+Coremap::LookupText(unsigned file, unsigned vpn)
+{
+    for (;;) {
+        int ppn = CachedText(file, vpn);
+        if (ppn == -1 || pinned[ppn] == 0)
+            return ppn;
+        framesUnpinned->Wait();  // Then look again: it may be gone.
+    }
+}
+
+/// The frame is pinned even if the text is already there: the daemon must
+/// not take it before the page table of `own` points to it.
+int
+Coremap::FindText(AddressSpace *own, unsigned vpn, unsigned file,
+                  bool *loaded, bool wait)
+{
+    lock->Acquire();
+    int ppn = LookupText(file, vpn);
+    if (ppn == -1 && !wait && freeFrames->NumClear() <= lowWater) {
+        lock->Release();
+        return -1;
+    }
+    if (ppn == -1) {
+        unsigned free = WaitForFrame();
+        ppn = LookupText(file, vpn);  // Loaded by somebody else meanwhile?
+        if (ppn == -1) {
+            ppn = free;
+            CacheText(ppn, file, vpn);
+        } else {
+            Release(free);
+            framesFreed->Broadcast();
+        }
+    }
+    *loaded = maps[ppn] != NULL;
+    if (*loaded) {
+        DEBUG('8', "SHARE TEXT: %u\n", ppn);
+        pinned[ppn]++;
+    }
+    AddMapping(ppn, own, vpn);
+    lock->Release();
+    return ppn;
+}
+
+/// Most neighbours are not cached, so look first without the lock, which
+/// would cost a few ticks and maybe a thread switch.  Nothing else runs
+/// meanwhile: the kernel only switches threads when it blocks or turns
+/// interrupts back on.
+int
+Coremap::MapText(AddressSpace *own, unsigned vpn, unsigned file)
+{
+    if (CachedText(file, vpn) == -1)
+        return -1;
+    lock->Acquire();
+    int ppn = LookupText(file, vpn);
+    if (ppn != -1) {
+        DEBUG('8', "SHARE TEXT: %u\n", ppn);
+        pinned[ppn]++;
+        AddMapping(ppn, own, vpn);
+    }
+    lock->Release();
+    return ppn;
+}
+
+void
+Coremap::Unpin(unsigned ppn)
+{
+    lock->Acquire();
+    ASSERT(pinned[ppn] > 0);
+    if (--pinned[ppn] == 0)
+        framesUnpinned->Broadcast();
+    if (numWaiting > 0)  // The daemon may have given up on pinned frames.
+        lowOnFrames->Signal();
+    lock->Release();
+}
+
+void
+Coremap::Free(AddressSpace *own, unsigned vpn, unsigned ppn)
+{
+    lock->Acquire();
+    FrameMapping **map = FindMapping(ppn, own, vpn);
+    if (*map != NULL) {
+        RemoveMapping(map);
+        if (maps[ppn] == NULL) {
+            Release(ppn);
+            framesFreed->Broadcast();
         }
     }
-    for(index=lastVictim+1; index < lastone; index++){
-        i = index % NUM_PHYS_PAGES;
-        if(ppnstat[i].dirty)
-            ;
-        else{
-            lastVictim = i;
-            return i;
+    lock->Release();
+}
+
+/// A single pass under the lock, instead of a call to `Free` per page.
+void
+Coremap::FreeAll(AddressSpace *own)
+{
+    unsigned freed = 0;
+
+    lock->Acquire();
+    while (own->mappings != NULL) {
+        unsigned ppn = own->mappings->ppn;
+        RemoveMapping(FindMapping(ppn, own, own->mappings->vpn));
+        if (maps[ppn] == NULL) {
+            Release(ppn);
+            freed++;
         }
     }
-    lastVictim++;
-    owner[lastVictim]->SaveToSwap(ppnToVpn[lastVictim]);
-    return lastVictim;
+    if (freed > 0)
+        framesFreed->Broadcast();
+    lock->Release();
 }
-*/
+
+bool
+Coremap::Share(unsigned ppn, AddressSpace *own, unsigned vpn,
+               AddressSpace *other)
+{
+    lock->Acquire();
+    bool mapped = *FindMapping(ppn, own, vpn) != NULL;
+    if (mapped)
+        AddMapping(ppn, other, vpn);
+    lock->Release();
+    return mapped;
+}
+
+/// Waiting for a free frame lets the daemon run, and it may evict `ppn`;
+/// so the mapping is looked up again afterwards.
 int
-Coremap::SelectVictim()
-{
-    int i, index, lastone = (lastVictim + NUM_PHYS_PAGES);
-    TranslationEntry auxEntry;
-    for(index=lastVictim+1; index < lastone; index++){
-        i = index % NUM_PHYS_PAGES; 
-        auxEntry = owner[i]->bringPage(ppnToVpn[i]);
-        if (auxEntry.use)
-            auxEntry.use = false;
-        else if (auxEntry.dirty)
-            ;
-        else{
-            lastVictim = i; 
-            return i;
+Coremap::Unshare(AddressSpace *own, unsigned vpn, unsigned ppn)
+{
+    int result = -1;
+
+    lock->Acquire();
+    if (*FindMapping(ppn, own, vpn) != NULL) {
+        if (maps[ppn]->next == NULL) {
+            result = ppn;  // The other sharers are gone.
+            UncacheText(ppn);  // About to be written.
+        }
+        else {
+            unsigned copy = WaitForFrame();
+            FrameMapping **map = FindMapping(ppn, own, vpn);
+            if (*map == NULL) {
+                Release(copy);  // Evicted while waiting; never mind.
+                framesFreed->Broadcast();
+            } else {
+                FrameMapping *moved = *map;
+                *map = moved->next;
+                moved->next = NULL;
+                moved->ppn  = copy;
+                maps[copy] = moved;
+                memcpy(&machine->mainMemory[copy * PAGE_SIZE],
+                       &machine->mainMemory[ppn * PAGE_SIZE], PAGE_SIZE);
+                result = copy;
+            }
         }
     }
+    lock->Release();
+    return result;
+}
 
-    for(index=lastVictim+1; index < lastone; index++){
-        i = index % NUM_PHYS_PAGES; 
-        auxEntry = owner[i]->bringPage(ppnToVpn[i]);
-        if (auxEntry.dirty)
-            ;
-        else{
-            lastVictim = i; 
-            return i;
+/// Where the pages come back from depends on the state of the frame:
+///
+/// * modified since it was loaded, by any of the pages mapping it: it is
+///   written to swap, and read back from there (`physicalPage == -2`);
+/// * clean, with a copy in swap: that copy is still good;
+/// * clean, never swapped: it is dropped, and loaded from the executable
+///   again, or zero filled (`physicalPage == -1`).
+///
+/// All the pages mapping a frame refer to the same swap slot.  If others
+/// refer to it too, pages that were shared once but are not any more, the
+/// slot keeps its contents for them, and a new one is taken.
+void
+Coremap::Evict(unsigned ppn)
+{
+    unsigned numMaps = 0;
+    bool dirty = false;
+
+    for (FrameMapping *map = maps[ppn]; map != NULL; map = map->next) {
+        dirty = map->space->Unmap(map->vpn) || dirty;
+        map->space->paging.evictions++;
+        numMaps++;
+    }
+    stats->paging.evictions++;
+    int slot = maps[ppn]->space->SwapSlot(maps[ppn]->vpn);
+    if (dirty) {
+        if (slot == -1 || swapArea->NumRefs(slot) > numMaps) {
+            for (unsigned i = 0; slot != -1 && i < numMaps; i++)
+                swapArea->Free(slot);
+            slot = swapArea->Allocate();
+            ASSERT(slot != -1);  // Out of swap space.
+            for (unsigned i = 1; i < numMaps; i++)
+                swapArea->Share(slot);
         }
+        DEBUG('8', "SAVE FRAME: %u\n", ppn);
+        swapArea->WritePage(slot, &machine->mainMemory[ppn * PAGE_SIZE]);
+        maps[ppn]->space->paging.swapOuts++;
+        stats->paging.swapOuts++;
+    } else
+        DEBUG('8', "DROP FRAME: %u\n", ppn);
+    while (maps[ppn] != NULL) {
+        maps[ppn]->space->PagedOut(maps[ppn]->vpn, slot);
+        RemoveMapping(&maps[ppn]);
     }
-    lastVictim = (lastVictim + 1) % NUM_PHYS_PAGES;
-//    ASSERT(ppnToVpn[lastVictim] >= 0);
-    DEBUG('4', "last: %d ppnToVpn: %d\n", lastVictim, ppnToVpn[lastVictim]);
-    return lastVictim;
 }
 
+/// The frames of a run are a single page each, so the run can be given
+/// swap slots of its own: the slots the pages had are dropped.  If there
+/// are not so many consecutive slots, the pages go one by one.
+void
+Coremap::EvictRun(const unsigned *frames, unsigned count)
+{
+    char pages[SWAP_CLUSTER * PAGE_SIZE];
+
+    ASSERT(count <= SWAP_CLUSTER);
+    int first = swapArea->AllocateRun(count);
+    if (first == -1) {
+        for (unsigned i = 0; i < count; i++)
+            Evict(frames[i]);
+        return;
+    }
+    DEBUG('8', "SAVE FRAMES: %u, %u pages\n", frames[0], count);
+    AddressSpace *space = maps[frames[0]]->space;
+    space->paging.evictions  += count;
+    space->paging.swapOuts   += count;
+    stats->paging.evictions  += count;
+    stats->paging.swapOuts   += count;
+    for (unsigned i = 0; i < count; i++) {
+        FrameMapping *map = maps[frames[i]];
+        map->space->Unmap(map->vpn);
+        int slot = map->space->SwapSlot(map->vpn);
+        if (slot != -1)
+            swapArea->Free(slot);
+        memcpy(&pages[i * PAGE_SIZE],
+               &machine->mainMemory[frames[i] * PAGE_SIZE], PAGE_SIZE);
+    }
+    swapArea->WritePages(first, count, pages);
+    for (unsigned i = 0; i < count; i++) {
+        FrameMapping *map = maps[frames[i]];
+        map->space->PagedOut(map->vpn, first + i);
+        RemoveMapping(&maps[frames[i]]);
+    }
+}
 
-/* FIFO POLICY
 int
-Coremap::SelectVictim()
+Coremap::Joins(AddressSpace *space, unsigned vpn)
+{
+    int ppn = space->Frame(vpn);
+
+    if (ppn == -1 || (unsigned) ppn == zeroFrame || !IsEvictable(ppn))
+        return -1;
+    FrameMapping *map = maps[ppn];
+    if (map->next != NULL || map->space != space || map->vpn != vpn
+          || !space->IsDirty(vpn) || !policy->IsInactive(ppn))
+        return -1;
+    return ppn;
+}
+
+/// The victim itself was chosen by the policy, so it may have been used
+/// lately; its neighbours must not have been.
+unsigned
+Coremap::Gather(unsigned ppn, unsigned *into, unsigned room)
+{
+    into[0] = ppn;
+    if (room > SWAP_CLUSTER)
+        room = SWAP_CLUSTER;
+    if (maps[ppn]->next != NULL || !IsDirty(ppn))
+        return 1;
+
+    AddressSpace *space = maps[ppn]->space;
+    unsigned first = maps[ppn]->vpn, last = first, count = 1;
+    int next;
+    while (count < room && first > 0
+           && (next = Joins(space, first - 1)) != -1) {
+        pinned[next] = 1;
+        first--;
+        count++;
+    }
+    while (count < room && (next = Joins(space, last + 1)) != -1) {
+        pinned[next] = 1;
+        last++;
+        count++;
+    }
+    for (unsigned vpn = first; vpn <= last; vpn++)
+        into[vpn - first] = space->Frame(vpn);
+    return count;
+}
+
+/// The lock is held all along, so the owners of the victims cannot go away
+/// in the middle, and faults wait for the batch to be done.  Victims are
+/// all chosen first, each with the run of pages going out with it, and
+/// dirty ones written back one run after the other.
+unsigned
+Coremap::Reclaim(unsigned count)
+{
+    unsigned n = 0, numRuns = 0;
+
+    ASSERT(count <= highWater);
+
+    while (n < count) {
+        int victim = policy->SelectVictim();
+        if (victim == -1)
+            break;
+        DEBUG('p', "Victim NUMBER: %d\n", victim);
+        ASSERT((unsigned) victim < numFrames);
+        pinned[victim] = 1;  // Do not pick it twice.
+        runs[numRuns] = Gather(victim, &victims[n], count - n);
+        n += runs[numRuns++];
+    }
+    for (unsigned i = 0, r = 0; r < numRuns; i += runs[r++])
+        if (runs[r] == 1)
+            Evict(victims[i]);
+        else {
+            maps[victims[i]]->space->paging.clusterEvictions += runs[r] - 1;
+            stats->paging.clusterEvictions += runs[r] - 1;
+            EvictRun(&victims[i], runs[r]);
+        }
+    for (unsigned i = 0; i < n; i++)
+        Release(victims[i]);
+    return n;
+}
+
+/// Evictions run with the lock held, from the choice of the victims to the
+/// last `AddressSpace::PagedOut`.
+void
+Coremap::WaitForEvictions()
+{
+    lock->Acquire();
+    lock->Release();
+}
+
+void
+Coremap::Pageout()
+{
+    lock->Acquire();
+    for (;;) {
+        while (freeFrames->NumClear() >= lowWater
+               && (freeFrames->NumClear() > 0 || numWaiting == 0))
+            lowOnFrames->Wait();
+        DEBUG('p', "Pageout: %u free frames\n", freeFrames->NumClear());
+        while (freeFrames->NumClear() < highWater)
+            if (Reclaim(highWater - freeFrames->NumClear()) == 0) {
+                // Everything is pinned; wait for `Unpin`.
+                lowOnFrames->Wait();
+            }
+        framesFreed->Broadcast();
+    }
+}
+
+unsigned
+Coremap::NumFrames()
+{
+    return numFrames;
+}
+
+unsigned
+Coremap::ZeroFrame()
+{
+    return zeroFrame;
+}
+
+bool
+Coremap::IsEvictable(unsigned ppn)
+{
+    return freeFrames->Test(ppn) && maps[ppn] != NULL && pinned[ppn] == 0;
+}
+
+bool
+Coremap::IsReferenced(unsigned ppn)
+{
+    if (!freeFrames->Test(ppn))
+        return false;
+    for (FrameMapping *map = maps[ppn]; map != NULL; map = map->next)
+        if (map->space->IsReferenced(map->vpn))
+            return true;
+    return false;
+}
+
+bool
+Coremap::Referenced(unsigned ppn)
+{
+    bool used = false;
+
+    if (!freeFrames->Test(ppn))
+        return false;
+    for (FrameMapping *map = maps[ppn]; map != NULL; map = map->next)
+        used = map->space->TestAndClearUse(map->vpn) || used;
+    return used;
+}
+
+bool
+Coremap::IsDirty(unsigned ppn)
+{
+    if (!freeFrames->Test(ppn))
+        return false;
+    for (FrameMapping *map = maps[ppn]; map != NULL; map = map->next)
+        if (map->space->IsDirty(map->vpn))
+            return true;
+    return false;
+}
+
+void
+Coremap::Sample()
 {
-    nextVictim = ++nextVictim % nitems;
-    return nextVictim;
+    policy->Sample();
 }
-*/
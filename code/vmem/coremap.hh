@@ -1,33 +1,234 @@
-//COREMAP
+/// Data structures to keep track of physical memory when pages are brought
+/// in on demand.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
 
 #ifndef _COREMAP_HH_
 #define _COREMAP_HH_
 
 #include "address_space.hh"
 #include "machine.hh"
-#include "bitmap.hh"
+#include "frame_allocator.hh"
+#include "replacement.hh"
 
-/*
-typedef struct _pageStatus {
-    bool used;
-    bool dirty;
-} pageStatus;
-*/
 
-class Coremap: public BitMap
+class Lock;
+class Condition;
+
+/// A page mapping a frame.
+///
+/// Mappings are in two lists: those of the frame, and those of the address
+/// space, so that either can be gone through without looking at the rest
+/// of memory.
+class FrameMapping {
+public:
+    AddressSpace *space;
+    unsigned vpn;
+    unsigned ppn;
+    FrameMapping *next;  ///< Next mapping of the same frame.
+    FrameMapping *nextInSpace, *prevInSpace;  ///< Of the same space.
+};
+
+/// The text held by a frame: page `vpn` of the executable whose file header
+/// is at sector `file`.
+class TextPage {
+public:
+    bool valid;  ///< Does the frame hold text at all?
+    unsigned file;
+    unsigned vpn;
+    int next;  ///< Next frame holding text in the same hash bucket, or -1.
+};
+
+/// Physical frames in use, and the pages mapping each one.
+///
+/// A frame is usually mapped by a single page, but after a `Fork` parent
+/// and child share their frames, copy-on-write, until one of them writes.
+/// The number of mappings of a frame is its reference count: the frame is
+/// free when the last one goes away.
+///
+/// Frames holding program text double as a page cache: every process
+/// running the same executable maps them read-only, instead of loading a
+/// copy of its own.  A text page is only cached while some process maps it.
+///
+/// Page faults take frames from a pool of free ones.  A kernel thread, the
+/// pageout daemon, keeps the pool filled: it wakes up when the number of
+/// free frames drops below `lowWater`, and evicts pages, chosen with a
+/// replacement policy, until there are `highWater` free frames again.
+///
+/// A frame is pinned from the moment it is handed out until its page is
+/// loaded, so that the daemon does not take it in between.  Pins are
+/// counted, since several processes may be mapping the same text frame.
+///
+/// One frame, the zero frame, is always full of zeros.  Pages of
+/// uninitialized data and stack map it read-only until they are first
+/// written.  Such mappings are not recorded: the frame is never evicted nor
+/// freed.
+///
+/// When the daemon picks a dirty page, the dirty pages around it in the
+/// same address space that were not used lately go out with it, to
+/// consecutive swap slots, and are written in a single request.
+///
+/// Everything is kept per frame, so that physical memory may be large:
+/// frames are found through a free list, cached text through a hash table,
+/// and the pages mapping a frame through its own list.  An address space
+/// going away drops its mappings through its own list too.
+class Coremap
 {
 public:
-    Coremap(int n);
-    int Find(AddressSpace* addr, unsigned i);
-    
+
+    /// Use the first `numFrames` frames of physical memory, replacing pages
+    /// with the policy called `policy` (see `NewReplacementPolicy`).  The
+    /// frame right after them is the zero frame.
+    Coremap(unsigned numFrames, const char *policy);
+
+    ~Coremap();
+
+    /// Fork the pageout daemon.
+    void StartPageout();
+
+    /// Return a pinned frame for page `vpn` of `owner`, waiting for the
+    /// pageout daemon if there is no free frame.  Unless `wait` is set,
+    /// only frames that can be spared without waking the daemon are given,
+    /// and -1 is returned otherwise.
+    int Find(AddressSpace *owner, unsigned vpn, bool wait = true);
+
+    /// Return a pinned frame holding text page `vpn` of the executable whose
+    /// file header is at sector `file`, now mapped by page `vpn` of
+    /// `owner` too.  `*loaded` tells whether the text is already there;
+    /// otherwise the caller loads it.  `wait` is as for `Find`.
+    int FindText(AddressSpace *owner, unsigned vpn, unsigned file,
+                 bool *loaded, bool wait = true);
+
+    /// Like `FindText`, but only if the text is already loaded; return -1
+    /// otherwise.
+    int MapText(AddressSpace *owner, unsigned vpn, unsigned file);
+
+    /// Drop a pin on frame `ppn`; once there are none left, it may be
+    /// evicted.
+    void Unpin(unsigned ppn);
+
+    /// Drop the mapping of frame `ppn` by page `vpn` of `owner`, freeing the
+    /// frame if it was the last one.  Nothing is done if the daemon already
+    /// took the frame.
+    void Free(AddressSpace *owner, unsigned vpn, unsigned ppn);
+
+    /// Drop every mapping of `owner`, freeing the frames nobody else maps.
+    void FreeAll(AddressSpace *owner);
+
+    /// Let page `vpn` of `other` map frame `ppn` too, if page `vpn` of
+    /// `owner` still does.  Return whether it did.
+    bool Share(unsigned ppn, AddressSpace *owner, unsigned vpn,
+               AddressSpace *other);
+
+    /// Give page `vpn` of `owner`, mapping the shared frame `ppn`, a frame
+    /// of its own.  If nobody else maps `ppn` any more, that is `ppn`
+    /// itself; otherwise it is a pinned copy.  Return -1 if the daemon took
+    /// `ppn` in the meantime.
+    int Unshare(AddressSpace *owner, unsigned vpn, unsigned ppn);
+
+    /// Wait until no eviction is under way.  Pages that were being taken
+    /// out of memory are then in swap, or nowhere if they were clean.
+    void WaitForEvictions();
+
+    /// Body of the pageout daemon.
+    void Pageout();
+
+    /// Number of frames managed.
+    unsigned NumFrames();
+
+    /// The frame full of zeros.
+    unsigned ZeroFrame();
+
+    /// Use and dirty bits of the page held by frame `ppn`.  `Referenced`
+    /// clears the use bit.
+
+    bool IsReferenced(unsigned ppn);
+    bool Referenced(unsigned ppn);
+    bool IsDirty(unsigned ppn);
+
+    /// Whether frame `ppn` holds a page that may be evicted.
+    bool IsEvictable(unsigned ppn);
+
+    /// Let the policy look at the use bits; called by the timer.
+    void Sample();
+
 private:
-    int SelectVictim();
-    AddressSpace *owner[NUM_PHYS_PAGES];
-    int ppnToVpn[NUM_PHYS_PAGES];
-//    pageStatus ppnstat[NUM_PHYS_PAGES];
-    int nextVictim;
-    int lastVictim;
-    int nitems;
+    FrameMapping **maps;  ///< Pages mapping each frame.
+    unsigned *pinned;  ///< Number of pins on each frame.
+    TextPage *texts;  ///< Text held by each frame.
+    int *textBuckets;  ///< First frame holding text in each hash bucket.
+    unsigned *victims;  ///< Frames being evicted by `Reclaim`.
+    unsigned *runs;  ///< Victims evicted together, in order.
+    FrameAllocator *freeFrames;  ///< Which frames are in use.
+    unsigned numFrames;
+    unsigned zeroFrame;
+    ReplacementPolicy *policy;
+
+    unsigned lowWater;  ///< Wake up the daemon below this many free frames.
+    unsigned highWater;  ///< The daemon stops at this many free frames.
+    unsigned numWaiting;  ///< Faults waiting for a free frame.
+    Lock *lock;  ///< Protects the frames, and serializes evictions.
+    Condition *lowOnFrames;  ///< The daemon waits here for work.
+    Condition *framesFreed;  ///< Faults wait here for a free frame.
+    Condition *framesUnpinned;  ///< Faults wait here for text being loaded.
+
+    /// Evict up to `count` frames in one go.  Return how many were freed.
+    unsigned Reclaim(unsigned count);
+
+    /// Take away frame `ppn` from every page mapping it.
+    void Evict(unsigned ppn);
+
+    /// Evict the `count` frames of a run gathered by `Gather`, writing
+    /// them to consecutive swap slots.
+    void EvictRun(const unsigned *frames, unsigned count);
+
+    /// Put in `into` the frames to evict along with the victim `ppn`, in
+    /// the order of their pages, and pin them.  At most `room` frames are
+    /// given, counting `ppn`; return how many.
+    unsigned Gather(unsigned ppn, unsigned *into, unsigned room);
+
+    /// Return the frame holding page `vpn` of `space` if it may be evicted
+    /// together with its neighbours: mapped by that page alone, dirty, and
+    /// inactive for the policy.  Otherwise return -1.
+    int Joins(AddressSpace *space, unsigned vpn);
+
+    /// Wait until there is a free frame, and return it.  The lock must be
+    /// held.
+    unsigned WaitForFrame();
+
+    /// Return the frame holding text page `vpn` of `file`, or -1.  Wait
+    /// while it is pinned, as it may still be loading.  The lock must be
+    /// held.
+    int LookupText(unsigned file, unsigned vpn);
+
+    /// Return the frame holding text page `vpn` of `file`, or -1.
+    int CachedText(unsigned file, unsigned vpn);
+
+    /// Record that frame `ppn` holds text page `vpn` of `file`, or that it
+    /// does not hold text any more.
+    void CacheText(unsigned ppn, unsigned file, unsigned vpn);
+    void UncacheText(unsigned ppn);
+
+    /// Hash bucket for text page `vpn` of `file`.
+    int *TextBucket(unsigned file, unsigned vpn);
+
+    /// Give back frame `ppn`, with nothing in it.  The lock must be held.
+    void Release(unsigned ppn);
+
+    /// Let page `vpn` of `space` map frame `ppn`.  The lock must be held.
+    void AddMapping(unsigned ppn, AddressSpace *space, unsigned vpn);
+
+    /// Take `map` out of the list of its frame, where `link` points to it,
+    /// and out of the list of its space, and delete it.
+    void RemoveMapping(FrameMapping **link);
+
+    /// Find the mapping of `ppn` by page `vpn` of `space`, and the pointer
+    /// to it in the list.
+    FrameMapping **FindMapping(unsigned ppn, AddressSpace *space,
+                               unsigned vpn);
 };
 
 #endif
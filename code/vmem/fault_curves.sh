@@ -0,0 +1,39 @@
+#!/bin/sh
+# Print page fault curves: run user programs under every page replacement
+# policy with a decreasing number of physical frames, and report the page
+# faults of each run.
+#
+# Usage, from a directory holding a `nachos` binary with *VMEM*:
+#
+#     ../vmem/fault_curves.sh [program...]
+#
+# Programs default to `matmult` and `sort` from `../test`.  Set `FRAMES` and
+# `POLICIES` to change what is measured.
+
+NACHOS=${NACHOS:-./nachos}
+FRAMES=${FRAMES:-"32 28 24 20 16 12 10 8 6 4"}
+POLICIES=${POLICIES:-"fifo clock eclock aging wsclock"}
+
+[ $# -eq 0 ] && set -- ../test/matmult ../test/sort
+
+for program in "$@"; do
+    echo "# $program: page faults"
+    printf '%-8s' frames
+    for policy in $POLICIES; do
+        printf '%10s' "$policy"
+    done
+    echo
+    for frames in $FRAMES; do
+        printf '%-8s' "$frames"
+        for policy in $POLICIES; do
+            # The console aborts at the end of its input, so never give it
+            # one.
+            faults=$(yes | $NACHOS -rp "$policy" -pm "$frames" -x "$program" \
+                     2>&1 \
+                     | sed -n 's/^Paging: faults \([0-9]*\).*/\1/p')
+            printf '%10s' "${faults:--}"
+        done
+        echo
+    done
+    echo
+done
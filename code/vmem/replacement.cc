@@ -0,0 +1,345 @@
+/// Routines implementing the page replacement policies.
+///
+/// * FIFO: evict the page that was loaded first.
+/// * Clock (second chance): sweep the frames, evicting the first page not
+///   referenced since the last sweep.
+/// * Enhanced clock: like clock, but prefer clean pages over dirty ones,
+///   since those are dropped without a swap write.
+/// * Aging: approximate LRU with a counter per frame, shifted right on
+///   every timer interrupt and with the use bit put in the top bit.
+/// * WSClock: clock over the time each page was last seen referenced,
+///   evicting clean pages out of the working set first.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "replacement.hh"
+#include "coremap.hh"
+#include "threads/system.hh"
+
+
+const char *DEFAULT_REPLACEMENT_POLICY = "eclock";
+
+ReplacementPolicy::ReplacementPolicy(Coremap *coremap_)
+{
+    coremap     = coremap_;
+    numFrames   = coremap->NumFrames();
+    hand        = 0;
+    resident    = new unsigned [numFrames];
+    residentAt  = new unsigned [numFrames];
+    numResident = 0;
+}
+
+ReplacementPolicy::~ReplacementPolicy()
+{
+    delete [] residentAt;
+    delete [] resident;
+}
+
+void
+ReplacementPolicy::Loaded(unsigned ppn)
+{
+    residentAt[ppn] = numResident;
+    resident[numResident++] = ppn;
+}
+
+/// The last resident frame takes the place of `ppn`.
+void
+ReplacementPolicy::Freed(unsigned ppn)
+{
+    unsigned last = resident[--numResident];
+
+    resident[residentAt[ppn]] = last;
+    residentAt[last] = residentAt[ppn];
+}
+
+void
+ReplacementPolicy::Sample()
+{}
+
+bool
+ReplacementPolicy::IsInactive(unsigned ppn)
+{
+    return !coremap->IsReferenced(ppn);
+}
+
+unsigned
+ReplacementPolicy::Advance()
+{
+    unsigned ppn = hand;
+
+    hand = (hand + 1) % numFrames;
+    return ppn;
+}
+
+class FifoPolicy : public ReplacementPolicy {
+public:
+    FifoPolicy(Coremap *coremap_) : ReplacementPolicy(coremap_)
+    {
+        prev  = new int [numFrames];
+        next  = new int [numFrames];
+        first = last = -1;
+    }
+
+    ~FifoPolicy()
+    {
+        delete [] next;
+        delete [] prev;
+    }
+
+    void Loaded(unsigned ppn)
+    {
+        ReplacementPolicy::Loaded(ppn);
+        prev[ppn] = last;
+        next[ppn] = -1;
+        if (last != -1)
+            next[last] = ppn;
+        else
+            first = ppn;
+        last = ppn;
+    }
+
+    /// Frames are freed out of order, by the pageout daemon and by exiting
+    /// processes, so the queue is doubly linked.
+    void Freed(unsigned ppn)
+    {
+        ReplacementPolicy::Freed(ppn);
+        if (prev[ppn] != -1)
+            next[prev[ppn]] = next[ppn];
+        else
+            first = next[ppn];
+        if (next[ppn] != -1)
+            prev[next[ppn]] = prev[ppn];
+        else
+            last = prev[ppn];
+    }
+
+    /// Only pinned frames are passed over, and those are few: the victims
+    /// already chosen by the same `Coremap::Reclaim`, and pages in transit.
+    int SelectVictim()
+    {
+        for (int ppn = first; ppn != -1; ppn = next[ppn])
+            if (coremap->IsEvictable(ppn))
+                return ppn;
+        return -1;
+    }
+
+    /// References do not count: any page may go.
+    bool IsInactive(unsigned ppn)
+    {
+        return true;
+    }
+
+private:
+    /// Resident frames, in the order they were loaded.
+    int *prev, *next;
+    int first, last;
+};
+
+class ClockPolicy : public ReplacementPolicy {
+public:
+    ClockPolicy(Coremap *coremap_) : ReplacementPolicy(coremap_)
+    {}
+
+    /// Ends within two sweeps: the first one clears every use bit.
+    int SelectVictim()
+    {
+        for (unsigned i = 0; i < 2 * numFrames; i++) {
+            unsigned ppn = Advance();
+            if (coremap->IsEvictable(ppn) && !coremap->Referenced(ppn))
+                return ppn;
+        }
+        return -1;
+    }
+};
+
+class EnhancedClockPolicy : public ReplacementPolicy {
+public:
+    EnhancedClockPolicy(Coremap *coremap_) : ReplacementPolicy(coremap_)
+    {}
+
+    /// Look for a page neither referenced nor dirty, without touching the
+    /// use bits.  Failing that, look for one not referenced but dirty,
+    /// clearing use bits on the way.  After both sweeps every use bit is
+    /// clear, so repeating them once is bound to find a victim, if there is
+    /// any.
+    int SelectVictim()
+    {
+        for (unsigned round = 0; round < 2; round++) {
+            for (unsigned i = 0; i < numFrames; i++) {
+                unsigned ppn = Advance();
+                if (coremap->IsEvictable(ppn) && !coremap->IsReferenced(ppn)
+                      && !coremap->IsDirty(ppn))
+                    return ppn;
+            }
+            for (unsigned i = 0; i < numFrames; i++) {
+                unsigned ppn = Advance();
+                if (coremap->IsEvictable(ppn) && !coremap->Referenced(ppn))
+                    return ppn;
+            }
+        }
+        return -1;
+    }
+};
+
+class AgingPolicy : public ReplacementPolicy {
+public:
+    AgingPolicy(Coremap *coremap_) : ReplacementPolicy(coremap_)
+    {
+        age       = new unsigned char [numFrames]();
+        threshold = 0;
+    }
+
+    ~AgingPolicy()
+    {
+        delete [] age;
+    }
+
+    /// A page just loaded counts as referenced now, so that it is not the
+    /// first one out.
+    void Loaded(unsigned ppn)
+    {
+        ReplacementPolicy::Loaded(ppn);
+        age[ppn] = 0x80;
+    }
+
+    void Sample()
+    {
+        for (unsigned i = 0; i < numResident; i++) {
+            unsigned ppn = resident[i];
+            age[ppn] = (age[ppn] >> 1)
+                       | (coremap->Referenced(ppn) ? 0x80 : 0);
+        }
+        threshold = 0;
+    }
+
+    /// Evict the first page, from the hand on, with a counter not above
+    /// `threshold`.  If there is none, evict the page with the lowest
+    /// counter, and let the following victims be as old as it: any counter
+    /// with the same highest bit.  So one sweep serves every victim of a
+    /// `Coremap::Reclaim`, instead of one each.
+    int SelectVictim()
+    {
+        int victim = -1;
+
+        for (unsigned i = 0; i < numFrames; i++) {
+            unsigned ppn = Advance();
+            if (!coremap->IsEvictable(ppn))
+                continue;
+            if (age[ppn] <= threshold)
+                return ppn;
+            if (victim == -1 || age[ppn] < age[victim])
+                victim = ppn;
+        }
+        if (victim != -1) {
+            hand = (victim + 1) % numFrames;
+            threshold = age[victim];
+            for (unsigned shift = 1; shift < 8; shift <<= 1)
+                threshold |= threshold >> shift;
+        }
+        return victim;
+    }
+
+private:
+    unsigned char *age;  ///< Reference history of each frame.
+
+    /// Highest counter a victim may have.  Counters change on every
+    /// `Sample`, and so it goes back to 0 then.
+    unsigned char threshold;
+};
+
+class WSClockPolicy : public ReplacementPolicy {
+public:
+    WSClockPolicy(Coremap *coremap_) : ReplacementPolicy(coremap_)
+    {
+        lastUse = new unsigned [numFrames]();
+        window  = WSCLOCK_WINDOW;
+    }
+
+    ~WSClockPolicy()
+    {
+        delete [] lastUse;
+    }
+
+    void Loaded(unsigned ppn)
+    {
+        ReplacementPolicy::Loaded(ppn);
+        lastUse[ppn] = stats->totalTicks;
+    }
+
+    void Sample()
+    {
+        for (unsigned i = 0; i < numResident; i++)
+            if (coremap->Referenced(resident[i]))
+                lastUse[resident[i]] = stats->totalTicks;
+        window = WSCLOCK_WINDOW;
+    }
+
+    /// Take the first clean page out of the working set.  Writes are not
+    /// asynchronous here, so instead of scheduling the write of old dirty
+    /// pages and moving on, remember the first of them and fall back to it
+    /// if no clean one shows up within `WSCLOCK_LOOKAHEAD` frames.
+    ///
+    /// If every page is in the working set, take the least recently used,
+    /// and narrow the working set to half its age, so that the following
+    /// victims of the same `Coremap::Reclaim` do not cost a sweep each.
+    int SelectVictim()
+    {
+        unsigned now = stats->totalTicks;
+        int oldDirty = -1;
+        int oldest = -1;
+        unsigned lookahead = 0;
+
+        for (unsigned i = 0; i < numFrames; i++) {
+            if (oldDirty != -1 && lookahead++ == WSCLOCK_LOOKAHEAD)
+                break;
+            unsigned ppn = Advance();
+            if (!coremap->IsEvictable(ppn))
+                continue;
+            if (coremap->Referenced(ppn))
+                lastUse[ppn] = now;
+            else if (now - lastUse[ppn] > window) {
+                if (!coremap->IsDirty(ppn))
+                    return ppn;
+                if (oldDirty == -1)
+                    oldDirty = ppn;
+            }
+            if (oldest == -1 || now - lastUse[ppn] > now - lastUse[oldest])
+                oldest = ppn;
+        }
+        int victim = oldDirty;
+        if (victim == -1 && oldest != -1) {
+            victim = oldest;
+            window = (now - lastUse[victim]) / 2;
+        }
+        if (victim != -1)
+            hand = (victim + 1) % numFrames;
+        return victim;
+    }
+
+private:
+    unsigned *lastUse;  ///< When each frame was last seen referenced.
+
+    /// Pages unreferenced for longer than this, in ticks, are out of the
+    /// working set.  Back to `WSCLOCK_WINDOW` on every `Sample`.
+    unsigned window;
+};
+
+ReplacementPolicy *
+NewReplacementPolicy(const char *name, Coremap *map)
+{
+    if (!strcmp(name, "fifo"))
+        return new FifoPolicy(map);
+    if (!strcmp(name, "clock"))
+        return new ClockPolicy(map);
+    if (!strcmp(name, "eclock"))
+        return new EnhancedClockPolicy(map);
+    if (!strcmp(name, "aging"))
+        return new AgingPolicy(map);
+    if (!strcmp(name, "wsclock"))
+        return new WSClockPolicy(map);
+    return NULL;
+}
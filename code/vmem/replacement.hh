@@ -0,0 +1,75 @@
+/// Page replacement policies.
+///
+/// When physical memory is full, the `Coremap` asks its policy which frame
+/// to take.  Policies only look at frames through the coremap, which knows
+/// the page held by each frame and where its use and dirty bits are.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_REPLACEMENT__HH
+#define NACHOS_VMEM_REPLACEMENT__HH
+
+
+class Coremap;
+
+/// Policy used when none is given with `-rp`.
+extern const char *DEFAULT_REPLACEMENT_POLICY;
+
+/// How long a page may go unreferenced, in ticks, before WSClock considers
+/// it out of the working set.
+const unsigned WSCLOCK_WINDOW = 2000;
+
+/// How many frames WSClock looks past an old dirty page for a clean one,
+/// before taking the dirty page.
+const unsigned WSCLOCK_LOOKAHEAD = 16;
+
+class ReplacementPolicy {
+public:
+
+    /// Manage the frames of `coremap`.
+    ReplacementPolicy(Coremap *coremap);
+
+    virtual ~ReplacementPolicy();
+
+    /// Choose the frame to evict, among those `Coremap::IsEvictable` says
+    /// may be.  Return -1 if there is none.
+    virtual int SelectVictim() = 0;
+
+    /// A page was just loaded into frame `ppn`.
+    virtual void Loaded(unsigned ppn);
+
+    /// Frame `ppn` is free again.
+    virtual void Freed(unsigned ppn);
+
+    /// Called on every timer interrupt, to keep track of references.
+    virtual void Sample();
+
+    /// Whether frame `ppn` is worth little enough to be evicted along with
+    /// a victim next to it.  By default, if it was not referenced lately.
+    virtual bool IsInactive(unsigned ppn);
+
+protected:
+    Coremap *coremap;
+    unsigned numFrames;
+    unsigned hand;  ///< Next frame to look at, for the clock policies.
+
+    /// Frames holding a page, in no particular order, so that `Sample`
+    /// does not go through all of memory.
+    unsigned *resident;
+    unsigned numResident;
+    /// Where each frame is in `resident`.
+    unsigned *residentAt;
+
+    /// Move `hand` to the next frame and return the one it was on.
+    unsigned Advance();
+};
+
+/// Create the policy called `name` (`fifo`, `clock`, `eclock`, `aging` or
+/// `wsclock`) for `map`.  Return `NULL` if there is no such policy.
+ReplacementPolicy *NewReplacementPolicy(const char *name, Coremap *map);
+
+
+#endif
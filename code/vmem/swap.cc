@@ -0,0 +1,338 @@
+/// Routines to manage the swap area.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "swap.hh"
+#include "compress.hh"
+#include "threads/system.hh"
+
+
+/// * `first` is the first sector to keep the pages in, one per sector.
+/// * `fileName` is the name of the file to keep the pages in.
+/// * `numSlots` is the number of pages the area holds.
+/// * `cachePages` is the size of the compressed cache, in pages.
+#ifdef FILESYS
+SwapArea::SwapArea(unsigned first, unsigned numSlots_, unsigned cachePages)
+{
+    firstSector = first;
+#else
+SwapArea::SwapArea(const char *fileName, unsigned numSlots_,
+                   unsigned cachePages)
+{
+    name     = fileName;
+    file     = NULL;
+#endif
+    numSlots = numSlots_;
+    slots    = new BitMap(numSlots);
+    refs     = new unsigned [numSlots]();
+
+    numChunks     = cachePages * PAGE_SIZE / SWAP_CACHE_CHUNK;
+    pool          = new char [numChunks * SWAP_CACHE_CHUNK];
+    nextChunk     = new int [numChunks];
+    for (unsigned i = 0; i < numChunks; i++)
+        nextChunk[i] = i + 1 < numChunks ? (int) i + 1 : -1;
+    freeChunks    = numChunks > 0 ? 0 : -1;
+    numFreeChunks = numChunks;
+
+    firstChunk = new int [numSlots];
+    packedSize = new unsigned [numSlots];
+    older      = new int [numSlots];
+    newer      = new int [numSlots];
+    for (unsigned i = 0; i < numSlots; i++)
+        firstChunk[i] = -1;
+    oldest = newest = -1;
+}
+
+SwapArea::~SwapArea()
+{
+#ifndef FILESYS
+    delete file;
+#endif
+    delete [] newer;
+    delete [] older;
+    delete [] packedSize;
+    delete [] firstChunk;
+    delete [] nextChunk;
+    delete [] pool;
+    delete [] refs;
+    delete slots;
+}
+
+#ifndef FILESYS
+void
+SwapArea::Open()
+{
+    DEBUG('8', "Creating swap file %s, %u slots\n", name, numSlots);
+    fileSystem->Create(name, numSlots * PAGE_SIZE);
+    file = fileSystem->Open(name);
+    ASSERT(file != NULL);
+}
+#endif
+
+int
+SwapArea::Allocate()
+{
+    int slot = slots->Find();
+
+    DEBUG('8', "Allocating swap slot %d\n", slot);
+    if (slot != -1)
+        refs[slot] = 1;
+    return slot;
+}
+
+void
+SwapArea::Share(unsigned slot)
+{
+    ASSERT(slots->Test(slot));
+    refs[slot]++;
+}
+
+void
+SwapArea::Free(unsigned slot)
+{
+    ASSERT(slots->Test(slot) && refs[slot] > 0);
+    if (--refs[slot] == 0) {
+        Uncache(slot);
+        slots->Clear(slot);
+    }
+}
+
+int
+SwapArea::AllocateRun(unsigned count)
+{
+    int first = slots->FindRun(count);
+
+    DEBUG('8', "Allocating %u swap slots from %d\n", count, first);
+    for (unsigned i = 0; first != -1 && i < count; i++)
+        refs[first + i] = 1;
+    return first;
+}
+
+unsigned
+SwapArea::NumRefs(unsigned slot)
+{
+    return refs[slot];
+}
+
+void
+SwapArea::WritePage(unsigned slot, const char *from)
+{
+    WritePages(slot, 1, from);
+}
+
+void
+SwapArea::ReadPage(unsigned slot, char *into)
+{
+    ReadPages(slot, 1, into);
+}
+
+/// Pages that do not go to the cache are written out in runs.
+void
+SwapArea::WritePages(unsigned slot, unsigned count, const char *from)
+{
+    unsigned run = 0;  // Pages to write, right before page `i`.
+
+    for (unsigned i = 0; i < count; i++) {
+        ASSERT(slots->Test(slot + i));
+        if (!CachePage(slot + i, &from[i * PAGE_SIZE]))
+            run++;
+        else if (run > 0) {
+            WriteToFile(slot + i - run, run, &from[(i - run) * PAGE_SIZE]);
+            run = 0;
+        }
+    }
+    if (run > 0)
+        WriteToFile(slot + count - run, run, &from[(count - run) * PAGE_SIZE]);
+}
+
+/// Pages that are not in the cache are read in runs.
+void
+SwapArea::ReadPages(unsigned slot, unsigned count, char *into)
+{
+    unsigned run = 0;  // Pages to read, right before page `i`.
+
+    for (unsigned i = 0; i < count; i++) {
+        ASSERT(slots->Test(slot + i));
+        if (firstChunk[slot + i] == -1) {
+            run++;
+            stats->numSwapCacheMisses++;
+            continue;
+        }
+        Uncompress(slot + i, &into[i * PAGE_SIZE]);
+        stats->numSwapCacheHits++;
+        if (run > 0) {
+            ReadFromFile(slot + i - run, run, &into[(i - run) * PAGE_SIZE]);
+            run = 0;
+        }
+    }
+    if (run > 0)
+        ReadFromFile(slot + count - run, run, &into[(count - run) * PAGE_SIZE]);
+}
+
+#ifdef FILESYS
+void
+SwapArea::Sectors(unsigned slot, unsigned count, unsigned *sectors)
+{
+    ASSERT(PAGE_SIZE == SECTOR_SIZE && slot + count <= numSlots);
+    for (unsigned i = 0; i < count; i++)
+        sectors[i] = firstSector + slot + i;
+}
+#endif
+
+void
+SwapArea::WriteToFile(unsigned slot, unsigned count, const char *from)
+{
+    DEBUG('8', "Writing swap slots %u to %u\n", slot, slot + count - 1);
+#ifdef FILESYS
+    unsigned sectors[SWAP_CLUSTER];
+    ASSERT(count <= SWAP_CLUSTER);
+    Sectors(slot, count, sectors);
+    synchDisk->WriteSectors(sectors, count, from);
+#else
+    if (file == NULL)
+        Open();
+    int written = file->WriteAt(from, count * PAGE_SIZE, slot * PAGE_SIZE);
+    ASSERT(written == (int) (count * PAGE_SIZE));
+#endif
+    stats->numSwapDiskWrites += count;
+    stats->numSwapWriteRequests++;
+}
+
+void
+SwapArea::ReadFromFile(unsigned slot, unsigned count, char *into)
+{
+    DEBUG('8', "Reading swap slots %u to %u\n", slot, slot + count - 1);
+#ifdef FILESYS
+    unsigned sectors[SWAP_CLUSTER];
+    ASSERT(count <= SWAP_CLUSTER);
+    Sectors(slot, count, sectors);
+    synchDisk->ReadSectors(sectors, count, into);
+#else
+    ASSERT(file != NULL);
+    int read = file->ReadAt(into, count * PAGE_SIZE, slot * PAGE_SIZE);
+    ASSERT(read == (int) (count * PAGE_SIZE));
+#endif
+    stats->numSwapReadRequests++;
+}
+
+/// Pages that would not get any smaller skip the cache, and so do those
+/// bigger than the whole cache.  The old copy of the slot is dropped
+/// either way.
+bool
+SwapArea::CachePage(unsigned slot, const char *from)
+{
+    char packed[PAGE_SIZE];
+
+    Uncache(slot);
+    unsigned size = numChunks > 0 ? Compress(from, PAGE_SIZE,
+                                             packed, PAGE_SIZE - 1)
+                                  : 0;
+    unsigned chunks = divRoundUp(size, SWAP_CACHE_CHUNK);
+    if (size == 0 || chunks > numChunks)
+        return false;
+    while (numFreeChunks < chunks)
+        WriteBack();
+    Cache(slot, packed, size);
+    stats->numSwapCompressed++;
+    stats->swapCompressedBytes += size;
+    return true;
+}
+
+void
+SwapArea::Cache(unsigned slot, const char *packed, unsigned size)
+{
+    int *link = &firstChunk[slot];
+
+    DEBUG('8', "Caching swap slot %u, %u bytes\n", slot, size);
+    for (unsigned done = 0; done < size; done += SWAP_CACHE_CHUNK) {
+        int chunk = freeChunks;
+        ASSERT(chunk != -1);
+        freeChunks = nextChunk[chunk];
+        numFreeChunks--;
+        memcpy(&pool[chunk * SWAP_CACHE_CHUNK], &packed[done],
+               size - done < SWAP_CACHE_CHUNK ? size - done : SWAP_CACHE_CHUNK);
+        *link = chunk;
+        link  = &nextChunk[chunk];
+    }
+    *link = -1;
+    packedSize[slot] = size;
+
+    older[slot] = newest;
+    newer[slot] = -1;
+    if (newest != -1)
+        newer[newest] = slot;
+    else
+        oldest = slot;
+    newest = slot;
+}
+
+void
+SwapArea::Uncompress(unsigned slot, char *into)
+{
+    char packed[PAGE_SIZE];
+    unsigned size = packedSize[slot], done = 0;
+
+    for (int chunk = firstChunk[slot]; chunk != -1;
+         chunk = nextChunk[chunk], done += SWAP_CACHE_CHUNK)
+        memcpy(&packed[done], &pool[chunk * SWAP_CACHE_CHUNK],
+               size - done < SWAP_CACHE_CHUNK ? size - done : SWAP_CACHE_CHUNK);
+    Decompress(packed, size, into, PAGE_SIZE);
+}
+
+void
+SwapArea::Uncache(unsigned slot)
+{
+    int chunk = firstChunk[slot];
+
+    if (chunk == -1)
+        return;
+    while (chunk != -1) {
+        int next = nextChunk[chunk];
+        nextChunk[chunk] = freeChunks;
+        freeChunks = chunk;
+        numFreeChunks++;
+        chunk = next;
+    }
+    firstChunk[slot] = -1;
+
+    if (older[slot] != -1)
+        newer[older[slot]] = newer[slot];
+    else
+        oldest = newer[slot];
+    if (newer[slot] != -1)
+        older[newer[slot]] = older[slot];
+    else
+        newest = older[slot];
+}
+
+/// Writing to the file may switch threads.  Meanwhile the pages can still
+/// be read from the cache, and only leave it once on disk, unless freed by
+/// then.  Pages are only written to swap by the coremap, one batch at a
+/// time, so nobody else writes back or caches pages in the meantime.
+void
+SwapArea::WriteBack()
+{
+    char pages[SWAP_CLUSTER * PAGE_SIZE];
+    unsigned first = oldest, count = 0;
+
+    ASSERT(oldest != -1);
+    while (count < SWAP_CLUSTER && first + count < numSlots
+           && firstChunk[first + count] != -1) {
+        Uncompress(first + count, &pages[count * PAGE_SIZE]);
+        count++;
+    }
+    WriteToFile(first, count, pages);
+    stats->numSwapWritebacks += count;
+    for (unsigned i = 0; i < count; i++)
+        Uncache(first + i);
+}
+
+unsigned
+SwapArea::NumFree()
+{
+    return slots->NumClear();
+}
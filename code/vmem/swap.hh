@@ -0,0 +1,162 @@
+/// Data structures to manage the swap area.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_VMEM_SWAP__HH
+#define NACHOS_VMEM_SWAP__HH
+
+
+#include "filesys/open_file.hh"
+#include "machine/machine.hh"
+#include "userprog/bitmap.hh"
+
+
+/// Number of pages the swap file can hold.  With the real file system, the
+/// swap area is instead as big as the region of the disk kept for it.
+const unsigned NUM_SWAP_SLOTS = 1024;
+
+/// Size of the compressed swap cache, in pages, unless told otherwise.
+const unsigned DEFAULT_SWAP_CACHE_PAGES = 8;
+
+/// The compressed swap cache is handed out in pieces of this many bytes.
+const unsigned SWAP_CACHE_CHUNK = 16;
+
+/// Most pages moved between memory and the swap file in one request.
+const unsigned SWAP_CLUSTER = 8;
+
+/// The swap area, shared by every address space.
+///
+/// It is a single file divided into page-sized “slots”, handed out by a
+/// bitmap.  An address space takes a slot for a page the first time the page
+/// is evicted, and gives it back when the address space is destroyed.
+///
+/// After a `Fork`, parent and child refer to the same slots, so slots count
+/// their references, and are only free when the last one is dropped.
+///
+/// The file itself is only created when the first page is written, so that
+/// running programs that never swap costs no file system operations at all.
+///
+/// With the real file system, the file is instead the region at the end of
+/// the volume that formatting keeps out of the free map (see
+/// `FileSystem::SwapStart`): slot `s` is sector `SwapStart() + s`.  A file
+/// would be bound by `MAX_FILE_SIZE` and take an entry of the directory;
+/// this way swapping never touches the directory nor the free map, and
+/// cannot fail for lack of either.
+///
+/// In front of the file there is a cache of compressed pages: pages written
+/// to swap are compressed and kept in memory, and only reach the file when
+/// the cache is full, oldest first.  Pages that do not compress go to the
+/// file right away.  A page read back stays in the cache, as its copy in
+/// swap, until written again or freed.  The cache is kernel memory, apart
+/// from the frames of the machine.
+///
+/// Pages next to each other in an address space are usually written out
+/// together, to consecutive slots, and read back together.  Runs of
+/// consecutive slots move to and from the file in a single request, up to
+/// `SWAP_CLUSTER` pages, so that they cost one seek instead of one each.
+class SwapArea {
+public:
+
+    /// Set up a swap area of `numSlots` pages, kept in the file `fileName`,
+    /// or in the sectors from `first` on with the real file system, with a
+    /// compressed cache of `cachePages` pages; none if 0.
+#ifdef FILESYS
+    SwapArea(unsigned first, unsigned numSlots, unsigned cachePages);
+#else
+    SwapArea(const char *fileName, unsigned numSlots, unsigned cachePages);
+#endif
+
+    /// Close the swap file.
+    ~SwapArea();
+
+    /// Return a free slot, with one reference, or -1 if the swap area is
+    /// full.
+    int Allocate();
+
+    /// Return the first of `count` consecutive free slots, each with one
+    /// reference, or -1 if there are not so many in a row.
+    int AllocateRun(unsigned count);
+
+    /// Add a reference to `slot`.
+    void Share(unsigned slot);
+
+    /// Drop a reference to `slot`, freeing it if it was the last one.
+    void Free(unsigned slot);
+
+    /// Number of references to `slot`.
+    unsigned NumRefs(unsigned slot);
+
+    /// Copy a page between memory and a slot.
+
+    void WritePage(unsigned slot, const char *from);
+    void ReadPage(unsigned slot, char *into);
+
+    /// Copy `count` pages, one after the other in memory, between memory
+    /// and the consecutive slots from `slot` on.
+
+    void WritePages(unsigned slot, unsigned count, const char *from);
+    void ReadPages(unsigned slot, unsigned count, char *into);
+
+    /// Number of slots not in use.
+    unsigned NumFree();
+
+private:
+#ifdef FILESYS
+    unsigned firstSector;  ///< Sector of slot 0.
+#else
+    const char *name;  ///< Name of the swap file.
+    OpenFile *file;  ///< The swap file; `NULL` until first needed.
+#endif
+    unsigned numSlots;  ///< Size of the swap area, in pages.
+    BitMap *slots;  ///< Slots in use.
+    unsigned *refs;  ///< References to each slot.
+
+    /// The compressed cache, `numChunks` chunks of `SWAP_CACHE_CHUNK` bytes.
+    char *pool;
+    unsigned numChunks;
+    int *nextChunk;  ///< Next chunk of the same page, or free.
+    int freeChunks;  ///< First free chunk, or -1.
+    unsigned numFreeChunks;
+
+    int *firstChunk;  ///< First chunk of each slot, or -1 if not cached.
+    unsigned *packedSize;  ///< Compressed size of each slot cached.
+    int *older, *newer;  ///< Cached slots, in the order they were written.
+    int oldest, newest;
+
+#ifdef FILESYS
+    /// Put in `sectors` those of the `count` slots from `slot` on.
+    void Sectors(unsigned slot, unsigned count, unsigned *sectors);
+#else
+    /// Create and open the swap file.
+    void Open();
+#endif
+
+    /// Write `count` pages to consecutive slots of the file, or read them
+    /// from there, in a single request.
+    void WriteToFile(unsigned slot, unsigned count, const char *from);
+    void ReadFromFile(unsigned slot, unsigned count, char *into);
+
+    /// Compress the page `from` into the cache, as `slot`.  Return false if
+    /// it does not compress, or does not fit at all.
+    bool CachePage(unsigned slot, const char *from);
+
+    /// Keep the `size` bytes of `packed` in the cache, as `slot`.  There
+    /// must be chunks enough.
+    void Cache(unsigned slot, const char *packed, unsigned size);
+
+    /// Decompress the cached copy of `slot` into `into`.
+    void Uncompress(unsigned slot, char *into);
+
+    /// Drop the cached copy of `slot`, if any.
+    void Uncache(unsigned slot);
+
+    /// Move the oldest page in the cache to the file, together with the
+    /// cached pages in the slots right after it.
+    void WriteBack();
+};
+
+
+#endif